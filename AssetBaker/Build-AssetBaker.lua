@@ -0,0 +1,57 @@
+project "AssetBaker"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   targetdir "Binaries/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   files {
+	 "Source/**.h",
+	 "Source/**.cpp",
+	 "../Libraries/Source/glad/**.c",
+	 "../Libraries/Source/stb_image/stb_image.cpp"
+   }
+
+   includedirs
+   {
+      "Source",
+	 "../Engine/Source",
+	 "../Libraries/Include/GLFW",
+	 "../Libraries/Include/glad",
+	 "../Libraries/Include/KHR",
+   	 "../Libraries/Include/glm",
+   	 "../Libraries/Include/stb_image"
+   }
+
+   links
+   {
+      "Engine"
+   }
+
+   targetdir ("../Binaries/" .. OutputDir .. "/%{prj.name}")
+   objdir ("../Binaries/Intermediates/" .. OutputDir .. "/%{prj.name}")
+
+   -- Headless: nothing is drawn, so no window or GL libraries beyond what the engine pulls in
+   filter { "system:not windows" }
+       links { "pthread" }
+
+   filter "system:windows"
+       systemversion "latest"
+       defines { "WINDOWS" }
+
+   filter "configurations:Debug"
+       defines { "DEBUG" }
+       runtime "Debug"
+       symbols "On"
+
+   filter "configurations:Release"
+       defines { "RELEASE" }
+       runtime "Release"
+       optimize "On"
+       symbols "On"
+
+   filter "configurations:Dist"
+       defines { "DIST" }
+       runtime "Release"
+       optimize "On"
+       symbols "Off"
@@ -0,0 +1,453 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Engine/Headers/engineLog.h"
+#include "Engine/Headers/imageData.h"
+#include "Engine/Headers/mappedFile.h"
+#include "Engine/Headers/meshCache.h"
+#include "Engine/Headers/mipGenerator.h"
+#include "Engine/Headers/objLoader.h"
+#include "Engine/Headers/objParser.h"
+#include "Engine/Headers/pakArchive.h"
+#include "Engine/Headers/textureCompressor.h"
+#include "Engine/Headers/threadPool.h"
+
+#include "bakeGraph.h"
+#include "derivedDataCache.h"
+
+// Headless tool that turns the sources under Engine/Source/Engine into the baked files the runtime
+// prefers: .gmesh next to every OBJ and .ktx (or .mips.ktx) next to every image. With --pak, the
+// sources, baked files and shaders are then packed into one archive the runtime mounts.
+
+enum class BakeResult { Baked, Restored, Failed };
+
+struct CommandLine {
+    BakeSettings settings;
+    size_t workerProcesses = 0;
+    int workerIndex = -1;       // set in the child processes spawned by --workers
+    std::string jobsFile;
+    bool printGraph = false;
+    std::string pakPath;
+    std::string benchMode;
+    std::string benchFile;
+    int benchIterations = 5;
+    std::vector<std::string> forwardedArguments; // settings handed on to worker processes
+};
+
+void printUsage();
+bool parseCommandLine(int argc, char** argv, CommandLine& commandLine);
+int bake(const CommandLine& commandLine, const std::string& executable);
+int runWorker(const CommandLine& commandLine);
+BakeResult bakeNode(const AssetNode& node, const BakeGraph& graph, const BakeSettings& settings, const DerivedDataCache& cache);
+bool writePak(const BakeGraph& graph, const BakeSettings& settings, const std::string& pakPath);
+int benchParser(const std::string& objPath, int iterations);
+int benchMips(const std::string& imagePath, int iterations);
+
+int main(int argc, char** argv)
+{
+    CommandLine commandLine;
+    if (!parseCommandLine(argc, argv, commandLine)) {
+        printUsage();
+        return 2;
+    }
+
+    if (commandLine.benchMode == "parser") {
+        return benchParser(commandLine.benchFile, commandLine.benchIterations);
+    }
+    if (commandLine.benchMode == "mips") {
+        return benchMips(commandLine.benchFile, commandLine.benchIterations);
+    }
+    if (commandLine.workerIndex >= 0) {
+        return runWorker(commandLine);
+    }
+    return bake(commandLine, argv[0]);
+}
+
+void printUsage()
+{
+    std::cout << "Usage: AssetBaker [options]\n"
+        << "  --root <dir>            engine source directory with Models/ and Images/ (default ../Engine/Source/Engine)\n"
+        << "  --ddc <dir>             derived data cache and manifest directory (default DerivedData)\n"
+        << "  --force                 rebake everything\n"
+        << "  --workers <n>           bake in n worker processes sharing the derived data cache\n"
+        << "  --vertex-format <f>     float32, compact or quantized (default quantized, as the Editor loads)\n"
+        << "  --lods <n>              levels of detail per mesh part (default 4)\n"
+        << "  --uncompressed          write RGBA8 .mips.ktx instead of block-compressed .ktx\n"
+        << "  --mip-filter <f>        box, kaiser or lanczos (default kaiser)\n"
+        << "  --graph                 print the dependency graph, marking what is rebuilt\n"
+        << "  --verbose               print import, packing and LOD statistics for every model\n"
+        << "  --pak <file>            pack sources, baked files and shaders into an archive (the Editor mounts <root>/Engine.pak)\n"
+        << "  --bench parser <obj>    OBJ parser throughput per thread count\n"
+        << "  --bench mips <image>    SIMD against scalar mip generation per filter\n"
+        << "  --iterations <n>        repetitions per benchmark (default 5)\n";
+}
+
+bool parseCommandLine(int argc, char** argv, CommandLine& commandLine)
+{
+    BakeSettings& settings = commandLine.settings;
+    settings.meshOptions.decodeTextures = false;
+    settings.meshOptions.useMeshCache = true;
+    settings.meshOptions.vertexFormat = VertexFormat::CompactQuantized;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "--root" && hasValue) {
+            settings.rootDirectory = argv[++i];
+        }
+        else if (argument == "--ddc" && hasValue) {
+            settings.derivedDataDirectory = argv[++i];
+        }
+        else if (argument == "--force") {
+            settings.force = true;
+        }
+        else if (argument == "--uncompressed") {
+            settings.compressTextures = false;
+        }
+        else if (argument == "--vertex-format" && hasValue) {
+            std::string format = argv[++i];
+            if (format == "float32") settings.meshOptions.vertexFormat = VertexFormat::Float32;
+            else if (format == "compact") settings.meshOptions.vertexFormat = VertexFormat::Compact;
+            else if (format == "quantized") settings.meshOptions.vertexFormat = VertexFormat::CompactQuantized;
+            else return false;
+        }
+        else if (argument == "--lods" && hasValue) {
+            settings.meshOptions.lodLevels = static_cast<unsigned int>(std::atoi(argv[++i]));
+        }
+        else if (argument == "--mip-filter" && hasValue) {
+            std::string filter = argv[++i];
+            if (filter == "box") settings.mipOptions.filter = MipFilter::Box;
+            else if (filter == "kaiser") settings.mipOptions.filter = MipFilter::Kaiser;
+            else if (filter == "lanczos") settings.mipOptions.filter = MipFilter::Lanczos;
+            else return false;
+        }
+        else if (argument == "--workers" && hasValue) {
+            commandLine.workerProcesses = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (argument == "--worker-index" && hasValue) {
+            commandLine.workerIndex = std::atoi(argv[++i]);
+        }
+        else if (argument == "--jobs-file" && hasValue) {
+            commandLine.jobsFile = argv[++i];
+        }
+        else if (argument == "--graph") {
+            commandLine.printGraph = true;
+        }
+        else if (argument == "--verbose") {
+            EngineLog::Verbose = true;
+        }
+        else if (argument == "--pak" && hasValue) {
+            commandLine.pakPath = argv[++i];
+        }
+        else if (argument == "--bench" && i + 2 < argc) {
+            commandLine.benchMode = argv[++i];
+            commandLine.benchFile = argv[++i];
+            if (commandLine.benchMode != "parser" && commandLine.benchMode != "mips") {
+                return false;
+            }
+        }
+        else if (argument == "--iterations" && hasValue) {
+            commandLine.benchIterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            return false;
+        }
+    }
+
+    // The settings part of the command line, handed on to worker processes
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--workers" || argument == "--worker-index" || argument == "--jobs-file" || argument == "--iterations" || argument == "--pak") {
+            ++i;
+        }
+        else if (argument == "--bench") {
+            i += 2;
+        }
+        else if (argument != "--graph") {
+            commandLine.forwardedArguments.push_back(argument);
+        }
+    }
+
+    return true;
+}
+
+BakeResult bakeNode(const AssetNode& node, const BakeGraph& graph, const BakeSettings& settings, const DerivedDataCache& cache)
+{
+    // Outputs are named <source><extension>, and so are their cache entries
+    std::string extension = node.output.substr(node.path.size());
+    if (cache.Fetch(node.key, extension, node.output)) {
+        return BakeResult::Restored;
+    }
+
+    // A stale output must not be picked up by the importer or stored under the new key
+    std::error_code error;
+    std::filesystem::remove(node.output, error);
+
+    bool baked = false;
+    if (node.kind == AssetKind::Model) {
+        std::string mtlPath = node.dependencies.empty()
+            ? std::filesystem::path(node.path).replace_extension(".mtl").generic_string()
+            : graph.Nodes()[node.dependencies[0]].path;
+        ObjLoader loader(node.path, mtlPath, settings.meshOptions, false);
+        baked = loader.Error().empty() && std::filesystem::exists(node.output, error);
+    }
+    else if (settings.compressTextures) {
+        TextureBakeReport report;
+        baked = TextureCompressor::Bake(node.path, report, settings.mipOptions);
+        if (baked) {
+            std::cout << "Compressed '" << node.path << "': BC" << (report.format == BlockFormat::BC1 ? 1 : report.format == BlockFormat::BC3 ? 3 : 5)
+                << ", " << report.levels << " levels, " << report.uncompressedBytes / 1024 << " KB -> " << report.compressedBytes / 1024
+                << " KB, RMSE " << report.error.rmseColor << ", PSNR " << report.error.psnr << " dB\n";
+        }
+        std::filesystem::remove(MipGenerator::MipsPathFor(node.path), error);
+    }
+    else {
+        baked = MipGenerator::Bake(node.path, settings.mipOptions);
+        // The runtime prefers a compressed .ktx, so an old one would hide the new mips
+        std::filesystem::remove(TextureCompressor::CompressedPathFor(node.path), error);
+    }
+
+    if (!baked) {
+        return BakeResult::Failed;
+    }
+    if (!cache.Store(node.key, extension, node.output)) {
+        std::cerr << "Failed to store '" << node.output << "' in " << cache.Directory() << std::endl;
+    }
+    return BakeResult::Baked;
+}
+
+int bake(const CommandLine& commandLine, const std::string& executable)
+{
+    auto start = std::chrono::steady_clock::now();
+    const BakeSettings& settings = commandLine.settings;
+
+    BakeGraph graph(settings);
+    graph.LoadManifest();
+    if (!graph.Scan()) {
+        std::cerr << "Cannot read the assets under '" << settings.rootDirectory << "'" << std::endl;
+        return 1;
+    }
+    graph.MarkDirty();
+    if (commandLine.printGraph) {
+        graph.Print(std::cout);
+    }
+
+    std::vector<size_t> jobs;
+    for (size_t i = 0; i < graph.Nodes().size(); ++i) {
+        if (graph.Nodes()[i].dirty && !graph.Nodes()[i].output.empty()) {
+            jobs.push_back(i);
+        }
+    }
+
+    DerivedDataCache cache(settings.derivedDataDirectory);
+    std::vector<BakeResult> results(jobs.size(), BakeResult::Failed);
+    size_t workerCount = std::min(commandLine.workerProcesses, jobs.size());
+    if (workerCount > 1) {
+        // Workers bake every workerCount-th job of this list and leave their results in the cache
+        std::string jobsFile = (std::filesystem::path(settings.derivedDataDirectory) / "jobs.txt").generic_string();
+        {
+            std::ofstream file(jobsFile, std::ios::trunc);
+            for (size_t job : jobs) {
+                file << graph.Nodes()[job].path << "\n";
+            }
+        }
+
+        std::string command = "\"" + executable + "\"";
+        for (const std::string& argument : commandLine.forwardedArguments) {
+            command += " \"" + argument + "\"";
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t k = 0; k < workerCount; ++k) {
+            std::string workerCommand = command + " --workers " + std::to_string(workerCount) + " --worker-index " + std::to_string(k)
+                + " --jobs-file \"" + jobsFile + "\"";
+            workers.emplace_back([workerCommand]() { std::system(workerCommand.c_str()); });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        std::error_code error;
+        for (size_t j = 0; j < jobs.size(); ++j) {
+            const AssetNode& node = graph.Nodes()[jobs[j]];
+            std::string extension = node.output.substr(node.path.size());
+            if (std::filesystem::exists(node.output, error) && std::filesystem::exists(cache.PathFor(node.key, extension), error)) {
+                results[j] = BakeResult::Baked;
+            }
+        }
+    }
+    else {
+        ThreadPool::Shared().ParallelFor(jobs.size(), [&](size_t j) {
+            results[j] = bakeNode(graph.Nodes()[jobs[j]], graph, settings, cache);
+        });
+    }
+
+    size_t bakeable = 0;
+    for (const AssetNode& node : graph.Nodes()) {
+        bakeable += node.output.empty() ? 0 : 1;
+    }
+
+    size_t counts[3] = {};
+    for (size_t j = 0; j < jobs.size(); ++j) {
+        counts[static_cast<int>(results[j])]++;
+        const AssetNode& node = graph.Nodes()[jobs[j]];
+        if (results[j] == BakeResult::Failed) {
+            std::cerr << "Failed to bake '" << node.path << "'" << std::endl;
+            graph.Invalidate(jobs[j]);
+            continue;
+        }
+
+        std::cout << (results[j] == BakeResult::Restored ? "Restored '" : "Baked '") << node.output << "'";
+        std::vector<size_t> dependents = graph.Dependents(jobs[j]);
+        for (size_t d = 0; d < dependents.size(); ++d) {
+            std::cout << (d == 0 ? ", used by " : ", ") << graph.Nodes()[dependents[d]].path;
+        }
+        std::cout << "\n";
+    }
+
+    if (!graph.SaveManifest()) {
+        std::cerr << "Failed to write " << graph.ManifestPath() << std::endl;
+    }
+
+    std::chrono::duration<double, std::milli> milliseconds = std::chrono::steady_clock::now() - start;
+    std::cout << bakeable << " assets: " << counts[static_cast<int>(BakeResult::Baked)] << " baked, "
+        << counts[static_cast<int>(BakeResult::Restored)] << " restored from " << cache.Directory() << ", "
+        << counts[static_cast<int>(BakeResult::Failed)] << " failed, " << bakeable - jobs.size() << " up to date in "
+        << milliseconds.count() << " ms" << (workerCount > 1 ? " using " + std::to_string(workerCount) + " worker processes" : "") << "\n";
+
+    if (counts[static_cast<int>(BakeResult::Failed)]) {
+        return 1;
+    }
+    if (!commandLine.pakPath.empty() && !writePak(graph, settings, commandLine.pakPath)) {
+        std::cerr << "Failed to write " << commandLine.pakPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+bool writePak(const BakeGraph& graph, const BakeSettings& settings, const std::string& pakPath)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::path root(settings.rootDirectory);
+    PakWriter writer;
+
+    // Text compresses well; baked files are used in place from the mapping and images are already compressed
+    auto add = [&](const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        bool isText = extension == ".obj" || extension == ".mtl" || extension == ".vs" || extension == ".fs";
+        writer.Add(path.lexically_relative(root).generic_string(), path.generic_string(), isText);
+    };
+
+    std::error_code error;
+    for (const AssetNode& node : graph.Nodes()) {
+        add(node.path);
+        if (!node.output.empty() && std::filesystem::exists(node.output, error)) {
+            add(node.output);
+        }
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(root, error)) {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".vs" || extension == ".fs")) {
+            add(entry.path());
+        }
+    }
+
+    PakWriteReport report;
+    if (!writer.Write(pakPath, report)) {
+        return false;
+    }
+
+    std::chrono::duration<double, std::milli> milliseconds = std::chrono::steady_clock::now() - start;
+    std::cout << "Packed " << report.entries << " files (" << report.compressedEntries << " compressed) into '" << pakPath << "': "
+        << report.originalBytes / 1024 << " KB -> " << report.archiveBytes / 1024 << " KB in " << milliseconds.count() << " ms\n";
+    return true;
+}
+
+int runWorker(const CommandLine& commandLine)
+{
+    const BakeSettings& settings = commandLine.settings;
+    BakeGraph graph(settings);
+    graph.LoadManifest();
+    if (!graph.Scan()) {
+        return 1;
+    }
+
+    // One asset at a time: the other workers own the other cores, and the engine code still
+    // spreads a single large bake over the pool
+    DerivedDataCache cache(settings.derivedDataDirectory);
+    std::ifstream file(commandLine.jobsFile);
+    std::string path;
+    bool failed = false;
+    for (size_t j = 0; std::getline(file, path); ++j) {
+        if (commandLine.workerProcesses == 0 || j % commandLine.workerProcesses != static_cast<size_t>(commandLine.workerIndex)) {
+            continue;
+        }
+        const AssetNode* node = graph.Find(path);
+        if (!node || bakeNode(*node, graph, settings, cache) == BakeResult::Failed) {
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+int benchParser(const std::string& objPath, int iterations)
+{
+    MappedFile file(objPath);
+    if (!file.IsOpen()) {
+        std::cerr << "The file '" << objPath << "' could not be opened\n";
+        return 1;
+    }
+
+    double megabytes = file.Size() / (1024.0 * 1024.0);
+    size_t maxThreads = ThreadPool::Shared().ThreadCount() + 1;
+    std::cout << "Parsing '" << objPath << "' (" << megabytes << " MB), " << iterations << " iterations\n";
+    for (size_t threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        double total = 0.0;
+        for (int i = 0; i < iterations; ++i) {
+            ObjData data;
+            std::string error;
+            auto start = std::chrono::steady_clock::now();
+            if (!ObjParser::Parse(file.Data(), file.End(), data, error, threads)) {
+                std::cerr << "Parse failed: " << error << "\n";
+                return 1;
+            }
+            total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        double seconds = total / iterations;
+        std::cout << "  " << threads << " threads: " << seconds * 1000.0 << " ms, " << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s\n";
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+    return 0;
+}
+
+int benchMips(const std::string& imagePath, int iterations)
+{
+    ImageData image = ImageData::Load(imagePath);
+    if (!image.IsValid()) {
+        std::cerr << "Failed to load texture: " << imagePath << "\n";
+        return 1;
+    }
+
+    std::cout << "Mip chain of '" << imagePath << "' (" << image.width << "x" << image.height << "), " << iterations << " iterations, SIMD path "
+        << MipGenerator::SimdPath() << "\n";
+    const char* names[] = { "box", "kaiser", "lanczos" };
+    for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos }) {
+        MipBenchmark benchmark = MipGenerator::Benchmark(image, filter, iterations);
+        std::cout << "  " << names[static_cast<int>(filter)] << ": scalar " << benchmark.scalarMilliseconds << " ms, SIMD "
+            << benchmark.simdMilliseconds << " ms (" << (benchmark.simdMilliseconds > 0.0 ? benchmark.scalarMilliseconds / benchmark.simdMilliseconds : 0.0)
+            << "x), max difference " << benchmark.maxDifference << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include "bakeGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "Engine/Headers/hash.h"
+#include "Engine/Headers/mappedFile.h"
+#include "Engine/Headers/meshCache.h"
+#include "Engine/Headers/mipGenerator.h"
+#include "Engine/Headers/textureCompressor.h"
+#include "Engine/Headers/threadPool.h"
+
+namespace {
+
+    constexpr char MANIFEST_HEADER[] = "GMEngine bake manifest";
+    // An OBJ's mtllib comes before its geometry; stop looking once that starts
+    constexpr size_t MTLLIB_SEARCH_LINES = 1000;
+
+    // The whole field must be a number; a truncated or hand-edited manifest line fails instead of throwing
+    template <typename T>
+    bool ParseField(const std::string& field, T& value, int base = 10)
+    {
+        const char* end = field.data() + field.size();
+        auto [ptr, ec] = std::from_chars(field.data(), end, value, base);
+        return ec == std::errc() && ptr == end;
+    }
+
+    bool IsImage(const std::filesystem::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+    }
+
+    std::vector<std::filesystem::path> SortedFiles(const std::filesystem::path& directory)
+    {
+        std::vector<std::filesystem::path> files;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            if (entry.is_regular_file()) {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::string KindName(AssetKind kind)
+    {
+        switch (kind) {
+        case AssetKind::Model: return "model";
+        case AssetKind::Material: return "material";
+        default: return "image";
+        }
+    }
+
+}
+
+uint64_t BakeSettings::Hash(AssetKind kind) const
+{
+    uint64_t hash = static_cast<uint64_t>(kind);
+    if (kind == AssetKind::Model) {
+        hash = Hash::Combine(hash, meshOptions.CacheHash());
+        hash = Hash::Combine(hash, MeshCache::VERSION);
+    }
+    else if (kind == AssetKind::Image) {
+        hash = Hash::Combine(hash, compressTextures);
+        hash = Hash::Combine(hash, static_cast<uint64_t>(mipOptions.filter));
+        hash = Hash::Combine(hash, mipOptions.gammaCorrect);
+    }
+    return Hash::Combine(hash, BakeGraph::VERSION);
+}
+
+BakeGraph::BakeGraph(const BakeSettings& settings)
+    : m_settings(settings)
+{
+}
+
+std::string BakeGraph::ManifestPath() const
+{
+    return (std::filesystem::path(m_settings.derivedDataDirectory) / "manifest.txt").generic_string();
+}
+
+void BakeGraph::LoadManifest()
+{
+    m_manifest.clear();
+    std::ifstream file(ManifestPath());
+    std::string line;
+    if (!std::getline(file, line) || line != std::string(MANIFEST_HEADER) + " " + std::to_string(VERSION)) {
+        return;
+    }
+
+    // key, size, modification time, content hash, path, then the dependency paths; tab separated
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string key, size, modifiedTime, contentHash, path;
+        if (!std::getline(fields, key, '\t') || !std::getline(fields, size, '\t') || !std::getline(fields, modifiedTime, '\t')
+            || !std::getline(fields, contentHash, '\t') || !std::getline(fields, path, '\t')) {
+            continue;
+        }
+
+        // Sources without an entry count as dirty and are rebuilt
+        ManifestEntry entry;
+        if (!ParseField(key, entry.key, 16) || !ParseField(size, entry.source.size) || !ParseField(modifiedTime, entry.source.modifiedTime)
+            || !ParseField(contentHash, entry.source.contentHash, 16)) {
+            continue;
+        }
+        m_manifest[path] = entry;
+    }
+}
+
+bool BakeGraph::SaveManifest() const
+{
+    std::string path = ManifestPath();
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file << MANIFEST_HEADER << " " << VERSION << "\n";
+        for (const AssetNode& node : m_nodes) {
+            file << std::hex << node.key << std::dec << "\t" << node.source.size << "\t" << node.source.modifiedTime << "\t"
+                << std::hex << node.source.contentHash << std::dec << "\t" << node.path;
+            for (size_t dependency : node.dependencies) {
+                file << "\t" << m_nodes[dependency].path;
+            }
+            file << "\n";
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
+
+size_t BakeGraph::AddNode(AssetKind kind, const std::string& path)
+{
+    auto found = m_nodeByPath.find(path);
+    if (found != m_nodeByPath.end()) {
+        return found->second;
+    }
+
+    AssetNode& node = m_nodes.emplace_back();
+    node.kind = kind;
+    node.path = path;
+    m_nodeByPath[path] = m_nodes.size() - 1;
+    return m_nodes.size() - 1;
+}
+
+const AssetNode* BakeGraph::Find(const std::string& path) const
+{
+    auto found = m_nodeByPath.find(path);
+    return found == m_nodeByPath.end() ? nullptr : &m_nodes[found->second];
+}
+
+void BakeGraph::AddModelDependencies(size_t model)
+{
+    std::filesystem::path objPath = m_nodes[model].path;
+    std::ifstream file(objPath);
+    std::string line;
+    std::string library;
+    for (size_t lineNumber = 0; lineNumber < MTLLIB_SEARCH_LINES && std::getline(file, line); ++lineNumber) {
+        if (line.rfind("mtllib ", 0) == 0) {
+            library = line.substr(7);
+            library.erase(library.find_last_not_of(" \t\r") + 1);
+            break;
+        }
+        if (line.rfind("v ", 0) == 0 || line.rfind("f ", 0) == 0) {
+            break;
+        }
+    }
+
+    // Without an mtllib line the loaders fall back to the material file named after the model
+    std::filesystem::path mtlPath = library.empty()
+        ? std::filesystem::path(objPath).replace_extension(".mtl")
+        : objPath.parent_path() / library;
+    std::error_code error;
+    if (std::filesystem::exists(mtlPath, error)) {
+        size_t material = AddNode(AssetKind::Material, mtlPath.generic_string());
+        m_nodes[model].dependencies.push_back(material);
+    }
+}
+
+void BakeGraph::AddMaterialDependencies(size_t material)
+{
+    std::ifstream file(m_nodes[material].path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string type, texture;
+        iss >> type;
+        if (type != "map_Kd" || !(iss >> texture)) {
+            continue;
+        }
+
+        // Same lookup as ObjLoader::LoadMtlFile: texture names are relative to the Images directory
+        std::filesystem::path imagePath = std::filesystem::path(m_settings.rootDirectory) / "Images" / texture;
+        std::error_code error;
+        if (!std::filesystem::exists(imagePath, error)) {
+            continue;
+        }
+
+        size_t image = AddNode(AssetKind::Image, imagePath.generic_string());
+        std::vector<size_t>& dependencies = m_nodes[material].dependencies;
+        if (std::find(dependencies.begin(), dependencies.end(), image) == dependencies.end()) {
+            dependencies.push_back(image);
+        }
+    }
+}
+
+bool BakeGraph::Scan()
+{
+    m_nodes.clear();
+    m_nodeByPath.clear();
+
+    std::filesystem::path root(m_settings.rootDirectory);
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) {
+        return false;
+    }
+
+    for (const std::filesystem::path& file : SortedFiles(root / "Models")) {
+        if (file.extension() == ".obj") {
+            AddNode(AssetKind::Model, (root / "Models" / file.filename()).generic_string());
+        }
+        else if (file.extension() == ".mtl") {
+            AddNode(AssetKind::Material, (root / "Models" / file.filename()).generic_string());
+        }
+    }
+    for (const std::filesystem::path& file : SortedFiles(root / "Images")) {
+        if (IsImage(file)) {
+            AddNode(AssetKind::Image, (root / "Images" / file.filename()).generic_string());
+        }
+    }
+
+    // Following references may append materials and images; they are visited in turn
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes[i].kind == AssetKind::Model) {
+            AddModelDependencies(i);
+        }
+        else if (m_nodes[i].kind == AssetKind::Material) {
+            AddMaterialDependencies(i);
+        }
+    }
+
+    // Unchanged size and timestamp reuse the recorded hash; everything else is hashed in parallel
+    std::atomic<bool> described = true;
+    ThreadPool::Shared().ParallelFor(m_nodes.size(), [&](size_t i) {
+        AssetNode& node = m_nodes[i];
+        if (!SourceStamp::Describe(node.path, node.source)) {
+            described = false;
+            return;
+        }
+
+        auto recorded = m_manifest.find(node.path);
+        if (recorded != m_manifest.end() && recorded->second.source.size == node.source.size
+            && recorded->second.source.modifiedTime == node.source.modifiedTime) {
+            node.source.contentHash = recorded->second.source.contentHash;
+        }
+        else {
+            MappedFile file(node.path);
+            node.source.contentHash = file.IsOpen() ? Hash::Xxh64(file.Data(), file.Size()) : 0;
+        }
+
+        node.key = Hash::Combine(node.source.contentHash, m_settings.Hash(node.kind));
+        switch (node.kind) {
+        case AssetKind::Model:
+            // The .gmesh records the path it was baked for
+            node.key = Hash::Combine(node.key, Hash::Fnv1a64(node.path));
+            node.output = MeshCache::CachePathFor(node.path);
+            break;
+        case AssetKind::Image:
+            node.output = m_settings.compressTextures ? TextureCompressor::CompressedPathFor(node.path) : MipGenerator::MipsPathFor(node.path);
+            break;
+        case AssetKind::Material:
+            break;
+        }
+    });
+
+    return described;
+}
+
+void BakeGraph::MarkDirty()
+{
+    for (AssetNode& node : m_nodes) {
+        auto recorded = m_manifest.find(node.path);
+        std::error_code error;
+        node.dirty = m_settings.force || recorded == m_manifest.end() || recorded->second.key != node.key
+            || (!node.output.empty() && !std::filesystem::exists(node.output, error));
+    }
+}
+
+std::vector<size_t> BakeGraph::Dependents(size_t index) const
+{
+    std::vector<size_t> dependents;
+    std::vector<size_t> pending = { index };
+    while (!pending.empty()) {
+        size_t current = pending.back();
+        pending.pop_back();
+        for (size_t i = 0; i < m_nodes.size(); ++i) {
+            const std::vector<size_t>& dependencies = m_nodes[i].dependencies;
+            if (std::find(dependencies.begin(), dependencies.end(), current) != dependencies.end()
+                && std::find(dependents.begin(), dependents.end(), i) == dependents.end()) {
+                dependents.push_back(i);
+                pending.push_back(i);
+            }
+        }
+    }
+    return dependents;
+}
+
+void BakeGraph::Print(std::ostream& stream) const
+{
+    // Depth-first from every node nothing depends on; '*' marks what this run rebuilds
+    std::vector<bool> referenced(m_nodes.size(), false);
+    for (const AssetNode& node : m_nodes) {
+        for (size_t dependency : node.dependencies) {
+            referenced[dependency] = true;
+        }
+    }
+
+    auto print = [&](auto& self, size_t index, int depth) -> void {
+        const AssetNode& node = m_nodes[index];
+        stream << std::string(depth * 2, ' ') << (node.dirty ? "* " : "  ") << KindName(node.kind) << " " << node.path;
+        if (!node.output.empty()) {
+            stream << " -> " << node.output;
+        }
+        stream << "\n";
+        for (size_t dependency : node.dependencies) {
+            self(self, dependency, depth + 1);
+        }
+    };
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        if (!referenced[i]) {
+            print(print, i, 0);
+        }
+    }
+}
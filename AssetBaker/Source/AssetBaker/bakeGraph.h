@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "Engine/Headers/meshImportOptions.h"
+#include "Engine/Headers/mipGenerator.h"
+#include "Engine/Headers/sourceStamp.h"
+
+enum class AssetKind {
+    Model,    // .obj, baked to .gmesh
+    Material, // .mtl, not baked itself but links models to their images
+    Image     // .png/.jpg/..., baked to a compressed .ktx or an RGBA8 .mips.ktx
+};
+
+struct BakeSettings {
+    // Paths are built the way the runtime spells them, so the .gmesh path hash matches at load time
+    std::string rootDirectory = "../Engine/Source/Engine";
+    std::string derivedDataDirectory = "DerivedData";
+    MeshImportOptions meshOptions;
+    MipOptions mipOptions;
+    bool compressTextures = true;
+    bool force = false;
+
+    uint64_t Hash(AssetKind kind) const;
+};
+
+struct AssetNode {
+    AssetKind kind = AssetKind::Image;
+    std::string path;
+    std::vector<size_t> dependencies; // model -> material -> images
+    SourceStamp source;
+    uint64_t key = 0;    // source content and bake settings; a new key means the output is stale
+    std::string output;  // baked file next to the source, empty for materials
+    bool dirty = false;
+};
+
+// Assets under the root's Models and Images directories, their dependencies (OBJ -> MTL -> images)
+// and a manifest of what was baked from which content, so re-runs only bake what changed
+class BakeGraph
+{
+
+public:
+	static constexpr uint32_t VERSION = 1;
+
+private:
+	struct ManifestEntry {
+		SourceStamp source;
+		uint64_t key = 0;
+	};
+
+	BakeSettings m_settings;
+	std::vector<AssetNode> m_nodes;
+	std::unordered_map<std::string, size_t> m_nodeByPath;
+	std::unordered_map<std::string, ManifestEntry> m_manifest;
+
+public:
+	explicit BakeGraph(const BakeSettings& settings);
+
+	std::string ManifestPath() const;
+	void LoadManifest();
+	bool SaveManifest() const;
+
+	// Walks the directories, follows mtllib/map_Kd references and hashes every source
+	bool Scan();
+	// Flags nodes whose key changed since the manifest was written or whose output is missing
+	void MarkDirty();
+
+	const std::vector<AssetNode>& Nodes() const { return m_nodes; }
+	const AssetNode* Find(const std::string& path) const;
+	// Forgets the node's key so the next run retries it
+	void Invalidate(size_t index) { m_nodes[index].key = 0; }
+	// Models and materials that use `index`, directly or through a material
+	std::vector<size_t> Dependents(size_t index) const;
+	void Print(std::ostream& stream) const;
+
+private:
+	size_t AddNode(AssetKind kind, const std::string& path);
+	void AddModelDependencies(size_t model);
+	void AddMaterialDependencies(size_t material);
+};
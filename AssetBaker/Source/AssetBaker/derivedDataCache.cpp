@@ -0,0 +1,55 @@
+#include "derivedDataCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+namespace {
+
+    // Copies through a temporary next to the target, then renames it over the target
+    bool CopyAtomically(const std::string& from, const std::string& to)
+    {
+        std::error_code error;
+        if (!std::filesystem::exists(from, error)) {
+            return false;
+        }
+
+        // Random suffix: other threads and processes may be copying to the same target
+        std::string tempPath = to + ".tmp" + std::to_string(std::random_device()());
+        if (!std::filesystem::copy_file(from, tempPath, std::filesystem::copy_options::overwrite_existing, error)) {
+            return false;
+        }
+
+        std::filesystem::rename(tempPath, to, error);
+        if (error) {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+
+}
+
+DerivedDataCache::DerivedDataCache(const std::string& directory)
+    : m_directory(directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+}
+
+std::string DerivedDataCache::PathFor(uint64_t key, const std::string& extension) const
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(m_directory) / (std::string(name) + extension)).generic_string();
+}
+
+bool DerivedDataCache::Fetch(uint64_t key, const std::string& extension, const std::string& outputPath) const
+{
+    return CopyAtomically(PathFor(key, extension), outputPath);
+}
+
+bool DerivedDataCache::Store(uint64_t key, const std::string& extension, const std::string& outputPath) const
+{
+    return CopyAtomically(outputPath, PathFor(key, extension));
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Directory of baked files named by their bake key, shared by every baker process on the machine.
+// Entries are written to a temporary file and renamed into place, so concurrent bakers never see
+// half-written data; two bakers racing on the same key produce identical files.
+class DerivedDataCache
+{
+
+private:
+	std::string m_directory;
+
+public:
+	explicit DerivedDataCache(const std::string& directory);
+
+	const std::string& Directory() const { return m_directory; }
+	std::string PathFor(uint64_t key, const std::string& extension) const;
+
+	// Copies the entry for `key` to `outputPath`; false on a miss
+	bool Fetch(uint64_t key, const std::string& extension, const std::string& outputPath) const;
+	bool Store(uint64_t key, const std::string& extension, const std::string& outputPath) const;
+};
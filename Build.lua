@@ -18,3 +18,7 @@ group "Editor"
 	include "Editor/Build-Editor.lua"
 group ""
 
+group "Tools"
+	include "AssetBaker/Build-AssetBaker.lua"
+group ""
+
@@ -1,6 +1,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <filesystem>
 #include <map>
+#include <sstream>
 
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
@@ -12,9 +14,15 @@
 #include "Engine/Headers/ECS/Components/Transform.h"
 #include "Engine/Headers/ECS/Components/MeshRenderer.h"
 #include "Engine/Headers/ECS/Systems/Rendersystem.h"
+#include "Engine/Headers/materialTable.h"
+#include "Engine/Headers/shaderLibrary.h"
+#include "Engine/Headers/textureCache.h"
+#include "Engine/Headers/vfs.h"
 
 void processInput(GLFWwindow* window);
+void showStatsWindow(RenderSystem& renderSystem);
 void initializeImgui(GLFWwindow* window);
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
@@ -43,6 +51,14 @@ int main()
     glEnable(GL_DEPTH_TEST);
     initializeImgui(window);
 
+    // Warm starts load linked programs instead of compiling GLSL
+    ShaderLibrary::Shared().EnableBinaryCache("../Engine/Source/Engine/DerivedData/Shaders", (GLADloadproc)glfwGetProcAddress);
+
+    // Baked builds read every asset from one archive written by AssetBaker --pak; loose files still work without it
+    if (std::filesystem::exists("../Engine/Source/Engine/Engine.pak")) {
+        Vfs::Shared().Mount("../Engine/Source/Engine/Engine.pak", "../Engine/Source/Engine");
+    }
+
     int entityId = 1;
     int entityId2 = 2;
 
@@ -51,9 +67,16 @@ int main()
     transforms[entityId2] = transform;
 
     RenderSystem renderSystem(transforms, meshRenderers);
+    renderSystem.MeshAssets.ImportOptions.vertexFormat = VertexFormat::CompactQuantized;
+    // Textures stream their mips under a fixed ceiling; array layers always keep every level, so they stay off
+    TextureCache::Shared().SetStreamingBudget(256ull << 20);
+    // Loose files can be edited while the Editor runs; an archive cannot
+    if (Vfs::Shared().MountCount() == 0) {
+        renderSystem.WatchAssets({ "../Engine/Source/Engine/Models", "../Engine/Source/Engine/Images" });
+    }
     
-    renderSystem.AddNewRenderable(entityId, "../Engine/Source/Engine/Models/rose.obj", "../Engine/Source/Engine/Models/rose.mtl");
-    renderSystem.AddNewRenderable(entityId2, "../Engine/Source/Engine/Models/skibidiFortnite.obj", "../Engine/Source/Engine/Models/skibidiFortnite.mtl");
+    renderSystem.AddNewRenderableAsync(entityId, "../Engine/Source/Engine/Models/rose.obj", "../Engine/Source/Engine/Models/rose.mtl");
+    renderSystem.AddNewRenderableAsync(entityId2, "../Engine/Source/Engine/Models/skibidiFortnite.obj", "../Engine/Source/Engine/Models/skibidiFortnite.mtl");
 
 #ifdef NDEBUG
 #else
@@ -82,6 +105,7 @@ int main()
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         ImGui::ShowDemoWindow(); // Show demo window! :)
+        showStatsWindow(renderSystem);
 
         processInput(window);
 
@@ -120,6 +144,33 @@ void processInput(GLFWwindow* window)
         camera.ProcessKeyboard(camera.RIGHT, deltaTime);
 }
 
+void showStatsWindow(RenderSystem& renderSystem)
+{
+    ImGui::Begin("Stats");
+
+    ImGui::Text("Mesh assets: %zu, materials: %zu", renderSystem.MeshAssets.AssetCount(), MaterialTable::Shared().Count());
+    ImGui::Text("Drawn: %zu meshes, %zu draw calls, %zu triangles", renderSystem.LastFrame.drawnMeshes, renderSystem.LastFrame.drawCalls, renderSystem.LastFrame.triangles);
+    ImGui::Text("Instancing: %zu draws of %zu parts", renderSystem.LastFrame.instancedDraws, renderSystem.LastFrame.instances);
+    ImGui::Text("LOD error: %.2f px", renderSystem.LastFrame.lodPixelError);
+    ImGui::Text("State changes: %zu, uniform uploads: %zu", renderSystem.LastFrame.stateChanges, renderSystem.LastFrame.uniformUploads);
+
+    TextureCacheStats textures = TextureCache::Shared().Stats();
+    ImGui::Text("Textures: %llu resident (%llu compressed), %.2f MB", (unsigned long long)textures.residentTextures, (unsigned long long)textures.compressedTextures, textures.residentBytes / (1024.0 * 1024.0));
+    ImGui::Text("Texture arrays: %llu, %llu layers", (unsigned long long)textures.arrayTextures, (unsigned long long)textures.arrayLayers);
+    ImGui::Text("Streaming: %llu textures (%llu partial), %.2f / %.2f MB, %.2f MB in, %.2f MB evicted", (unsigned long long)textures.streamedTextures, (unsigned long long)textures.partialTextures,
+        textures.residentBytes / (1024.0 * 1024.0), textures.streamingBudget / (1024.0 * 1024.0), textures.streamedInBytes / (1024.0 * 1024.0), textures.evictedBytes / (1024.0 * 1024.0));
+    ImGui::Text("Texture cache: %.1f%% hits, %llu decodes, %.2f MB saved", textures.HitRate() * 100.0, (unsigned long long)textures.decodes, textures.savedBytes / (1024.0 * 1024.0));
+
+    const ShaderLibraryStats& shaders = ShaderLibrary::Shared().Stats();
+    ImGui::Text("Shaders: %zu programs for %llu requests, %llu from the binary cache, %llu compiled, %.1f ms", ShaderLibrary::Shared().Count(), (unsigned long long)shaders.requests,
+        (unsigned long long)shaders.binaryLoads, (unsigned long long)shaders.compiled, shaders.milliseconds);
+
+    VfsStats files = Vfs::Shared().Stats();
+    ImGui::Text("Files: %zu archives, %u archived (%u decompressed, %.2f MB), %u loose", Vfs::Shared().MountCount(), files.archivedOpens + files.decompressedOpens, files.decompressedOpens, files.decompressedBytes / (1024.0 * 1024.0), files.looseOpens);
+
+    ImGui::End();
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
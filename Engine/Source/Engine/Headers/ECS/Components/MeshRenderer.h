@@ -13,24 +13,30 @@
 #include "../../camera.h"
 #include "../../shaderHelper.h"
 #include "../../material.h"
+#include "../../meshAsset.h"
+#include "../../renderQueue.h"
 
 class MeshRenderer : Component {
 
 public:
-    std::vector<GLuint> VAOS;
-    std::vector<GLuint> VBOS;
-    std::unordered_map<std::string, Material> MaterialData;
-    std::vector<ModelPart> ModelParts;
+    MeshHandle Mesh;
+    // Level of detail drawn for each part of the mesh
+    std::vector<unsigned int> LodLevels;
+    // Drawn after every lower layer, whatever the depth; below RenderQueue::LAYER_COUNT
+    uint32_t Layer = 0;
 
 private:
-    std::unique_ptr<Shader> shader;
+    std::shared_ptr<Shader> shader; // shared with every renderer of the same program
+    std::shared_ptr<Shader> instancedShader; // its INSTANCED variant, used when the queue batches parts
 
 public:
-    MeshRenderer(int entityId);
+    MeshRenderer(int entityId, MeshHandle mesh);
     void SetShader();
-    void Render(Camera camera, glm::mat4 modelMatrix);
-
-private:
-    void RenderModelPart(const ModelPart& part, GLuint VAO);
+    // Picks for each part the coarsest level whose error stays under `maxPixelError` once projected with
+    // `pixelsPerUnit`. Coarser levels must also beat the limit by `hysteresis` so a mesh sitting near a
+    // switching distance does not flicker between levels.
+    void SelectLods(const MeshAsset& mesh, float pixelsPerUnit, float maxPixelError, float hysteresis);
+    // Queues a draw for every part at its selected level of detail
+    void Enqueue(const glm::mat4& modelMatrix, const MeshAsset& mesh, RenderQueue& queue);
 
 };
@@ -2,19 +2,75 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <string>
 
 #include "../Components/Transform.h"
 #include "../Components/MeshRenderer.h"
+#include "../../meshAssetRegistry.h"
+#include "../../fileWatcher.h"
+#include "../../renderQueue.h"
+#include "../../uniformBuffers.h"
+
+// What the last Render call drew
+struct RenderStats {
+    size_t drawnMeshes = 0;
+    size_t drawCalls = 0;
+    size_t instancedDraws = 0;
+    size_t instances = 0; // parts drawn by the instanced draws
+    size_t triangles = 0;
+    size_t stateChanges = 0; // program, VAO and texture binds
+    size_t uniformUploads = 0;
+    float lodPixelError = 0.0f;
+};
 
 class RenderSystem {
 
 public:
     std::map<int, std::shared_ptr<Transform>>& transforms;
     std::map<int, std::shared_ptr<MeshRenderer>>& meshRenderers;
+    MeshAssetRegistry MeshAssets;
+
+    // Time the GL thread may spend per frame uploading asynchronously imported models
+    double UploadBudgetMilliseconds = 2.0;
+
+    // Largest on-screen error, in pixels, a level of detail may introduce
+    float LodPixelError = 1.0f;
+    // Fraction by which a coarser level must beat LodPixelError before a mesh switches down to it
+    float LodHysteresis = 0.25f;
+    // Triangles per frame the pixel error is raised to stay under as the scene grows (0 disables)
+    size_t TriangleBudget = 1000000;
+
+    RenderStats LastFrame;
+
+private:
+    // Multiplier on LodPixelError adapted every frame to keep the scene within TriangleBudget
+    float m_lodErrorScale = 1.0f;
+    static constexpr float MAX_LOD_ERROR_SCALE = 64.0f;
+
+    std::unique_ptr<FileWatcher> m_assetWatcher;
+
+    static constexpr float NEAR_PLANE = 0.1f;
+    static constexpr float FAR_PLANE = 100.0f;
+
+    RenderQueue m_queue;
+    UniformBuffers m_uniforms;
+    uint32_t m_frameIndex = 0;
+    float m_lastFrameTime = 0.0f;
 
 public:
     RenderSystem(std::map<int, std::shared_ptr<Transform>>& transforms, std::map<int, std::shared_ptr<MeshRenderer>>& meshRenderers);
     void AddNewRenderable(int entityId, std::string objFilePath, std::string mtlFilePath);
+    // Registers the entity right away; it renders nothing until its model is imported and uploaded
+    void AddNewRenderableAsync(int entityId, std::string objFilePath, std::string mtlFilePath);
     void RemoveRenderable(int entityId);
+    // Re-imports models and textures whose files change in `directories` while the scene keeps running;
+    // an empty list stops watching
+    void WatchAssets(const std::vector<std::string>& directories);
     void Render(Camera camera);
-};
\ No newline at end of file
+
+private:
+    void ReloadChangedAssets();
+    // Tells the texture cache how much detail each part's texture shows at `pixelsPerUnit`
+    void RequestTextureDetail(const MeshAsset& mesh, float pixelsPerUnit);
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// EXT_texture_compression_s3tc is not part of the generated GL loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// 4x4 block formats the texture baker can produce
+enum class BlockFormat : uint32_t {
+    BC1, // RGB, 8 bytes per block
+    BC3, // RGBA, 16 bytes per block: BC4-style alpha plus a BC1 color block
+    BC5  // RG (normal maps), 16 bytes per block: two BC4 blocks
+};
+
+// Root mean square error per channel between an image and its compressed round trip
+struct BlockCompressionError {
+    double rmse[4] = {};
+    double rmseColor = 0.0; // over the channels the format stores
+    double psnr = 0.0;
+};
+
+// CPU encoder and reference decoder for the BCn formats. Images are tightly packed 8-bit rows of
+// `channels` (3 or 4) components; decoded images are always RGBA.
+class BlockCompression
+{
+
+public:
+	static size_t BlockBytes(BlockFormat format);
+	static size_t CompressedSize(BlockFormat format, int width, int height);
+	static uint32_t GlInternalFormat(BlockFormat format);
+	static bool FromGlInternalFormat(uint32_t internalFormat, BlockFormat& format);
+
+	static std::vector<unsigned char> Encode(BlockFormat format, const unsigned char* pixels, int width, int height, int channels);
+	static std::vector<unsigned char> Decode(BlockFormat format, const unsigned char* blocks, int width, int height);
+
+	// Compares `decoded` (RGBA) against the source pixels on the channels `format` keeps
+	static BlockCompressionError MeasureError(BlockFormat format, const unsigned char* pixels, int channels, const unsigned char* decoded, int width, int height);
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <atomic>
+
+namespace EngineLog {
+
+	// Timing and statistics lines (imports, program builds, archive mounts, hot reloads) go to std::cout
+	// only while this is on, and the import statistics are only gathered then. Errors always print.
+	inline std::atomic<bool> Verbose = false;
+
+}
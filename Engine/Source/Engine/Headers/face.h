@@ -1,9 +0,0 @@
-#pragma once
-
-#include <glm.hpp>
-
-struct Face {
-    glm::vec3 vertices[3];
-    glm::vec2 uvs[3];
-    glm::vec3 normals[3];
-};
\ No newline at end of file
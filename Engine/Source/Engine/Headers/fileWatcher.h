@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mpscQueue.h"
+
+struct FileChange {
+    std::string path; // "<watched directory>/<file name>"
+    std::chrono::steady_clock::time_point detected;
+};
+
+// Reports files written or moved into a set of directories (not recursive). A background thread
+// blocks on inotify on Linux and polls sizes and timestamps elsewhere or when inotify is unavailable.
+// A file is reported once it has been quiet for SETTLE_TIME, so a save written in several steps
+// is seen as one change.
+class FileWatcher
+{
+
+public:
+	static constexpr std::chrono::milliseconds SETTLE_TIME{ 50 };
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+private:
+	std::vector<std::string> m_directories;
+	MpscQueue<FileChange> m_changes;
+	std::atomic<bool> m_stopping = false;
+	bool m_usesInotify = false;
+	int m_inotify = -1;
+	std::unordered_map<int, std::string> m_directoryByWatch; // inotify watch descriptor -> directory
+	std::thread m_thread;
+
+public:
+	explicit FileWatcher(const std::vector<std::string>& directories);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool UsesInotify() const { return m_usesInotify; }
+	// Single consumer: changes settled since the last call, each path at most once
+	std::vector<FileChange> PollChanges();
+
+private:
+	bool OpenInotify();
+	void RunInotify();
+	void RunPolling();
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Hash {
+
+	// FNV-1a, cheap enough for short keys and usable at compile time
+	constexpr uint64_t Fnv1a64(std::string_view text, uint64_t hash = 0xcbf29ce484222325ull)
+	{
+		for (char c : text) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	// XXH64, for hashing file contents at memory bandwidth
+	uint64_t Xxh64(const void* data, size_t size, uint64_t seed = 0);
+
+	inline uint64_t Combine(uint64_t hash, uint64_t value)
+	{
+		return hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+	}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Decoded 8-bit RGB or RGBA pixels, rows top to bottom
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+
+    bool IsValid() const { return !pixels.empty(); }
+    size_t ByteSize() const { return pixels.size(); }
+
+    // Decodes a JPEG/PNG/... file read through the Vfs with stb_image; safe to call from worker threads
+    static ImageData Load(const std::string& filePath);
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs.h"
+#include "sourceStamp.h"
+
+// KTX 1.1 header (https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html), little endian only
+struct KtxHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+// One mip level of a 2D texture, pointing into the mapped file or a caller-owned buffer
+struct KtxLevel {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Baked 2D texture with its full mip chain, written next to the source image. Holds either
+// block-compressed levels (glType 0) or plain RGBA8 ones, and remembers the image it was built from.
+class KtxFile
+{
+
+private:
+	VfsFile m_file;
+	const KtxHeader* m_header = nullptr;
+	std::vector<KtxLevel> m_levels;
+	std::string m_path;
+	SourceStamp m_source;
+	uint64_t m_sourceOffset = 0; // of m_source in the file
+	bool m_hasSource = false;
+
+public:
+	// `header` supplies the GL format fields and base size; the level count comes from `levels`
+	static bool Write(const std::string& path, const KtxHeader& header, const std::vector<KtxLevel>& levels, const SourceStamp& source);
+	static KtxHeader MakeHeader(uint32_t glInternalFormat, uint32_t glFormat, uint32_t glType, int width, int height);
+
+	bool Open(const std::string& path);
+	// True when the file was baked from `sourcePath` as it is on disk now. A source that was only
+	// touched has its new modification time written back to the file.
+	bool IsFreshFor(const std::string& sourcePath);
+
+	bool IsOpen() const { return m_header != nullptr; }
+	bool IsCompressed() const { return m_header->glType == 0; }
+	const KtxHeader& Header() const { return *m_header; }
+	const std::vector<KtxLevel>& Levels() const { return m_levels; }
+	size_t DataBytes() const;
+};
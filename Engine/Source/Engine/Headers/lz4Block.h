@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+// LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md): a greedy
+// single-pass compressor and a bounds-checked decompressor. Blocks are interchangeable with the
+// reference implementation's LZ4_compress_default / LZ4_decompress_safe.
+namespace Lz4 {
+
+	// Worst-case compressed size of `size` input bytes
+	size_t CompressBound(size_t size);
+
+	// Returns the compressed size, or 0 if `capacity` is too small
+	size_t Compress(const char* source, size_t size, char* target, size_t capacity);
+
+	// False on malformed input or when the block does not decode to exactly `originalSize` bytes
+	bool Decompress(const char* source, size_t size, char* target, size_t originalSize);
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The view stays valid for the lifetime of the object.
+class MappedFile
+{
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_isOpen = false;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool IsOpen() const { return m_isOpen; }
+	const char* Data() const { return m_data; }
+	const char* End() const { return m_data + m_size; }
+	size_t Size() const { return m_size; }
+};
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <glm.hpp>
 
+// Dense index into MaterialTable::Shared()
+using MaterialId = uint32_t;
+constexpr MaterialId INVALID_MATERIAL = UINT32_MAX;
+
+// One `newmtl` block as parsed from an MTL file, before it is interned into the MaterialTable
+
 struct Material {
     glm::vec3 ambient;
     glm::vec3 diffuse;
@@ -11,4 +18,5 @@ struct Material {
     std::string diffuseMap;
     std::string diffuseTexture;
     unsigned int textureID;
+    int textureLayer = -1; // layer of the texture array `textureID` names, -1 for a 2D texture
 };
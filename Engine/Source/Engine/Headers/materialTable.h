@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <glm.hpp>
+
+#include "material.h"
+
+// Every material in use, interned once per MTL library and name and stored column by column, so a
+// draw reads its texture with an array index and MaterialIds can serve directly as batching keys.
+// Ids of released materials are reused, which keeps the columns dense. GL thread only.
+class MaterialTable
+{
+
+private:
+	std::vector<glm::vec3> m_ambient;
+	std::vector<glm::vec3> m_diffuse;
+	std::vector<glm::vec3> m_specular;
+	std::vector<float> m_shininess;
+	std::vector<GLuint> m_textures;
+	std::vector<int> m_layers;
+	std::vector<uint32_t> m_refCounts;
+	std::vector<std::string> m_keys;
+	std::vector<MaterialId> m_freeIds;
+	std::unordered_map<std::string, MaterialId> m_idsByKey;
+
+public:
+	static MaterialTable& Shared();
+
+	// Returns a new reference to the material `name` of `library`. The table takes over the texture
+	// reference in `material.textureID` (and `textureLayer`); interning a material again (a reloaded MTL) replaces its values.
+	MaterialId Intern(const std::string& library, const std::string& name, const Material& material);
+	// Drops a reference; the last one releases the texture and frees the id
+	void Release(MaterialId id);
+
+	size_t Count() const { return m_idsByKey.size(); }
+	bool IsLive(MaterialId id) const { return id < m_refCounts.size() && m_refCounts[id] > 0; }
+
+	const glm::vec3& Ambient(MaterialId id) const { return m_ambient[id]; }
+	const glm::vec3& Diffuse(MaterialId id) const { return m_diffuse[id]; }
+	const glm::vec3& Specular(MaterialId id) const { return m_specular[id]; }
+	float Shininess(MaterialId id) const { return m_shininess[id]; }
+	// A 2D texture when Layer is -1, otherwise the texture array holding the material's layer
+	GLuint Texture(MaterialId id) const { return m_textures[id]; }
+	int Layer(MaterialId id) const { return m_layers[id]; }
+
+private:
+	void ReleaseTexture(MaterialId id);
+};
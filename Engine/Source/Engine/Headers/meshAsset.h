@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "modelPart.h"
+#include "material.h"
+
+// Generational handle to a MeshAsset owned by a MeshAssetRegistry
+struct MeshHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != UINT32_MAX; }
+    bool operator==(const MeshHandle& other) const { return index == other.index && generation == other.generation; }
+};
+
+// GPU-resident model shared by every entity that renders it
+struct MeshAsset {
+    std::string key;
+    std::vector<GLuint> VAOS;
+    std::vector<GLuint> VBOS;
+    std::vector<GLuint> EBOS;
+    std::vector<MaterialId> Materials; // MaterialTable references, released with the mesh
+    std::vector<ModelPart> ModelParts;
+    glm::vec3 BoundsMin = glm::vec3(0.0f);
+    glm::vec3 BoundsMax = glm::vec3(0.0f);
+    bool IsLoaded = false;
+};
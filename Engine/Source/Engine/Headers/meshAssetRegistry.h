@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+
+#include "meshAsset.h"
+#include "objLoader.h"
+#include "mpscQueue.h"
+
+// Hands out reference-counted handles to meshes keyed by their canonical asset paths, so every
+// entity using the same model shares one import and one set of GL objects
+class MeshAssetRegistry
+{
+
+private:
+	struct Slot {
+		MeshAsset asset;
+		uint32_t generation = 0;
+		uint32_t refCount = 0;
+		uint32_t revision = 0; // bumped by every import started, so only the newest one is attached
+		// As first requested; the mesh cache is keyed by the path spelling
+		std::string objFilePath;
+		std::string mtlFilePath;
+	};
+
+	// A model imported on a worker thread, waiting for its GL upload
+	struct PendingUpload {
+		MeshHandle handle;
+		uint32_t revision = 0;
+		std::unique_ptr<ObjLoader> loader;
+		bool isReload = false;
+		std::chrono::steady_clock::time_point changed;
+	};
+
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	std::unordered_map<std::string, MeshHandle> m_handlesByKey;
+
+	std::shared_ptr<MpscQueue<PendingUpload>> m_importedMeshes;
+	std::unique_ptr<PendingUpload> m_uploadingMesh;
+
+public:
+	// Options every import started by Acquire uses
+	MeshImportOptions ImportOptions;
+
+public:
+	MeshAssetRegistry();
+
+	MeshAssetRegistry(const MeshAssetRegistry&) = delete;
+	MeshAssetRegistry& operator=(const MeshAssetRegistry&) = delete;
+
+	// Returns a new reference to the mesh, importing it only when nobody holds it yet. Async imports
+	// run on the shared ThreadPool and the mesh stays unloaded until ProcessUploads finishes it.
+	MeshHandle Acquire(const std::string& objFilePath, const std::string& mtlFilePath, bool async);
+	// Drops a reference; the GL objects are released with the last one and the textures handed back to the TextureCache
+	void Release(MeshHandle handle);
+
+	const MeshAsset* Get(MeshHandle handle) const;
+	uint32_t RefCount(MeshHandle handle) const;
+	size_t AssetCount() const { return m_handlesByKey.size(); }
+
+	// Re-imports every mesh whose OBJ or MTL is `changedPath` on the thread pool and returns how many.
+	// The meshes keep drawing their current buffers until ProcessUploads swaps the new ones in, under
+	// the same handles, so every MeshRenderer using them switches over in the same frame. A reload that
+	// fails to import is logged and keeps the current version.
+	size_t Reload(const std::string& changedPath, std::chrono::steady_clock::time_point changed = std::chrono::steady_clock::now());
+
+	// GL thread: uploads finished async imports until the budget is spent
+	void ProcessUploads(double budgetMilliseconds);
+
+private:
+	static std::string MakeKey(const std::string& objFilePath, const std::string& mtlFilePath);
+	static std::string ResolvePath(const std::string& path);
+	void ImportAsync(MeshHandle handle, bool isReload, std::chrono::steady_clock::time_point changed);
+	MeshHandle AllocateSlot(const std::string& key);
+	bool IsLive(MeshHandle handle) const;
+	static void AttachModel(MeshAsset& asset, ObjLoader& loader);
+	static void DeleteGpuObjects(std::vector<GLuint>& VAOS, std::vector<GLuint>& VBOS, std::vector<GLuint>& EBOS, std::vector<MaterialId>& materials);
+};
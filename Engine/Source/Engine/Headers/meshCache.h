@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "vfs.h"
+#include "meshImportOptions.h"
+#include "modelPart.h"
+#include "sourceStamp.h"
+
+// On-disk layout of a .gmesh file: header, part table, LOD table, material names, then 16-byte
+// aligned vertex and index blobs ready to hand to glBufferData.
+struct GMeshHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceModifiedTime;
+    uint64_t sourceHash;
+    uint64_t sourcePathHash;
+    uint32_t partCount;
+    uint32_t vertexStride;
+    uint32_t vertexFormat;
+    uint32_t lodCount;
+    uint64_t optionsHash; // MeshImportOptions::CacheHash of the import that wrote it
+};
+
+struct GMeshPart {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexType;
+    uint32_t materialNameLength;
+    uint32_t lodFirst;
+    uint32_t lodCount;
+    uint64_t materialNameOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    float uvDensity;
+    uint32_t reserved;
+};
+
+struct GMeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+};
+
+// Versioned binary cache of an imported model, written next to the source as `<source>.gmesh`
+// and memory-mapped on later loads
+class MeshCache
+{
+
+public:
+	static constexpr uint32_t VERSION = 5;
+
+private:
+	VfsFile m_file;
+	const GMeshHeader* m_header = nullptr;
+	const GMeshPart* m_parts = nullptr;
+	const GMeshLod* m_lods = nullptr;
+
+public:
+	static std::string CachePathFor(const std::string& sourcePath);
+	static bool Write(const std::string& sourcePath, const SourceStamp& source, const MeshImportOptions& options, const std::vector<ModelPart>& parts);
+
+	// Maps the cache of `sourcePath` and checks it was built from the current source: size and
+	// modification time first, falling back to a content hash when only the timestamp moved.
+	// A cache baked with another vertex format or other import options counts as stale.
+	bool Open(const std::string& sourcePath, const MeshImportOptions& options);
+
+	size_t PartCount() const { return m_header ? m_header->partCount : 0; }
+	VertexFormat Format() const { return static_cast<VertexFormat>(m_header->vertexFormat); }
+	const GMeshPart& Part(size_t index) const { return m_parts[index]; }
+	// Indexed by GMeshPart::lodFirst + level
+	const GMeshLod& Lod(size_t index) const { return m_lods[index]; }
+	std::string_view MaterialName(size_t index) const;
+	const void* VertexData(size_t index) const;
+	const void* IndexData(size_t index) const;
+	size_t VertexBytes(size_t index) const;
+	size_t IndexBytes(size_t index) const;
+
+	static size_t IndexSize(uint32_t indexType);
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "hash.h"
+#include "vertexFormat.h"
+
+struct MeshImportOptions {
+    // Number of chunks the OBJ text is split into and parsed on the shared ThreadPool.
+    // 0 uses every hardware thread, 1 parses on the calling thread only.
+    unsigned int parseThreads = 0;
+
+    // Load from and write to the baked `<obj>.gmesh` cache next to the source file
+    bool useMeshCache = true;
+
+    // Decode the MTL's textures alongside the import; offline tools that only want the geometry turn it off
+    bool decodeTextures = true;
+
+    // Place the textures in layers of texture arrays shared by every image of the same size and format,
+    // so parts with different materials can be drawn without rebinding textures (see TextureCache::AcquireLayer)
+    bool textureArrays = false;
+
+    // Merge parts sharing a material and reorder triangles and vertices for the GPU caches (see MeshOptimizer)
+    bool optimizeMeshes = true;
+
+    // Coarser levels of detail generated per part (see MeshSimplifier). Each keeps about `lodReduction`
+    // of the previous level's triangles and may move the surface by up to `lodMaxError` of the part's
+    // bounds diagonal in total.
+    unsigned int lodLevels = 4;
+    float lodReduction = 0.5f;
+    float lodMaxError = 0.1f;
+
+    // Synchronous imports without a mesh cache stream vertices straight into mapped GL buffers while the
+    // faces are read, instead of building the whole model in memory first. Only the attribute pools and
+    // `streamChunkBytes` of vertices and indices per material are resident. Skips the optimizer, the
+    // LODs and the cache write, and deduplicates vertices only within a chunk.
+    bool streamUpload = false;
+    size_t streamChunkBytes = 4 << 20;
+
+    // Layout of the uploaded vertex buffers. The compact formats shrink a vertex from 32 to 20 or 16 bytes.
+    VertexFormat vertexFormat = VertexFormat::Float32;
+
+    // Hash of the options that change the baked geometry, stored in the .gmesh so a cache built with
+    // other settings is rebuilt. The AssetBaker keys its model outputs on the same value.
+    uint64_t CacheHash() const
+    {
+        uint64_t hash = static_cast<uint64_t>(vertexFormat);
+        hash = Hash::Combine(hash, optimizeMeshes);
+        hash = Hash::Combine(hash, lodLevels);
+        hash = Hash::Combine(hash, std::bit_cast<uint32_t>(lodReduction));
+        hash = Hash::Combine(hash, std::bit_cast<uint32_t>(lodMaxError));
+        return hash;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "vertex.h"
+#include "objParser.h"
+
+// Post-transform cache behaviour of an index buffer under a simulated FIFO cache
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0;
+    size_t transformedVertices = 0;
+
+    // Average cache miss ratio: vertex shader invocations per triangle (0.5 is ideal, 3 is worst)
+    double Acmr() const { return triangles ? static_cast<double>(transformedVertices) / triangles : 0.0; }
+    // Average transformed vertex ratio: invocations per unique vertex (1 is ideal)
+    double Atvr() const { return vertices ? static_cast<double>(transformedVertices) / vertices : 0.0; }
+};
+
+// Reordering passes run on imported geometry before it is packed, cached and uploaded
+class MeshOptimizer
+{
+
+public:
+	// Entries of the FIFO cache assumed by the metrics and the overdraw pass
+	static constexpr size_t FIFO_CACHE_SIZE = 16;
+	// Entries of the LRU cache modelled by the Forsyth scoring
+	static constexpr size_t FORSYTH_CACHE_SIZE = 32;
+	// Largest ACMR increase the overdraw pass may trade for better depth rejection
+	static constexpr float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+public:
+	// Groups the faces of every range using the same material into one range, in order of first use,
+	// so each material becomes a single part and a single draw. Returns the number of ranges removed.
+	static size_t MergePartsByMaterial(ObjData& data);
+
+	// Forsyth's linear-speed vertex cache optimisation: greedily emits the triangle whose vertices
+	// score best in a simulated LRU cache, preferring vertices with few remaining triangles
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// Splits the cache-ordered triangles into clusters at cache flushes and sorts the clusters so the
+	// ones facing away from the mesh centre (likely occluders) draw first. Reverted when the ACMR
+	// grows by more than `acmrThreshold`.
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float acmrThreshold = OVERDRAW_ACMR_THRESHOLD);
+
+	// Renumbers vertices in order of first use so the vertex fetch walks memory forwards
+	static void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = FIFO_CACHE_SIZE);
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "vertex.h"
+
+// Quadric-error edge-collapse simplification (Garland & Heckbert) restricted to collapsing a vertex
+// onto one of its neighbours, so the remaining vertices keep their exact attributes and the result
+// indexes the original vertex buffer
+class MeshSimplifier
+{
+
+public:
+	// Cosine of the largest rotation a collapse may apply to a surviving triangle's normal
+	static constexpr float MIN_NORMAL_COSINE = 0.25f;
+
+public:
+	// Collapses edges cheapest first until at most `targetIndexCount` indices remain or every remaining
+	// collapse would move the surface by more than `maxError`. Vertices on UV/normal seams (positions
+	// shared by several vertices) and on open borders never move. `error` receives the largest
+	// collapse cost as an object-space distance.
+	static std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t targetIndexCount, float maxError, float& error);
+};
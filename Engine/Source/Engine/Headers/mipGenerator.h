@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "imageData.h"
+
+enum class MipFilter : uint32_t {
+    Box,     // 2x2 average
+    Kaiser,  // windowed sinc, radius 3, alpha 4: sharp with little ringing
+    Lanczos  // Lanczos-3: sharpest, rings on hard edges
+};
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Kaiser;
+    bool gammaCorrect = true; // filter color in linear light; alpha is always linear
+    bool useSimd = true;
+};
+
+struct MipBenchmark {
+    double scalarMilliseconds = 0.0;
+    double simdMilliseconds = 0.0;
+    int maxDifference = 0; // largest 8-bit difference between the two chains
+    const char* simdPath = "";
+};
+
+// Offline mip chain generator. Each level is filtered from the previous one in linear float
+// RGBA, so the chain is only quantized once per level. Uses AVX2 or SSE2 when the CPU has them
+// and a scalar reference path otherwise.
+class MipGenerator
+{
+
+public:
+	static std::string MipsPathFor(const std::string& imagePath);
+	// Instruction set the SIMD path dispatches to on this CPU: "AVX2", "SSE2" or "scalar"
+	static const char* SimdPath();
+
+	// RGBA8 levels from the base image (level 0, unfiltered) down to 1x1
+	static std::vector<ImageData> GenerateChain(const ImageData& image, const MipOptions& options = MipOptions());
+	// Writes the chain as uncompressed RGBA8 `<image>.mips.ktx`
+	static bool Bake(const std::string& imagePath, const MipOptions& options = MipOptions());
+
+	static MipBenchmark Benchmark(const ImageData& image, MipFilter filter, int iterations);
+};
@@ -2,10 +2,45 @@
 
 #include <string>
 #include <vector>
-#include "face.h"
+#include <cstdint>
+#include <cmath>
+#include "material.h"
+#include "vertex.h"
+#include "vertexFormat.h"
+
+// One level of detail: a range of the part's index buffer drawn in place of the full mesh
+struct ModelLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error; // largest object-space distance the surface moved from level 0
+};
+
+// Texture coordinate units per object-space unit of a surface whose triangles cover `positionArea`
+// in object space and `uvArea` in texture space
+inline float UvDensity(double positionArea, double uvArea)
+{
+    return positionArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / positionArea)) : 0.0f;
+}
 
 struct ModelPart {
     unsigned int vertexCount;
+    unsigned int indexCount; // every level of detail, stored back to back
+    std::vector<ModelLod> lods; // finest first; level 0 is the full mesh
+    unsigned int indexType; // GL_UNSIGNED_SHORT when every index fits in 16 bits, GL_UNSIGNED_INT otherwise
     std::string materialName;
-    std::vector<Face> faces;
-};
\ No newline at end of file
+    MaterialId materialId = INVALID_MATERIAL; // resolved from materialName when the model is uploaded
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    float uvDensity = 0.0f; // texture coordinate units per object-space unit, averaged over the surface
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    PositionDequantization dequantization; // uploaded as the positionScale/positionOffset uniforms
+
+    // CPU copies of the deduplicated geometry; released once uploaded
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    // `vertices` in vertexFormat when that is not Float32
+    std::vector<unsigned char> packedVertices;
+
+    const void* VertexData() const { return packedVertices.empty() ? static_cast<const void*>(vertices.data()) : packedVertices.data(); }
+    size_t VertexBytes() const { return packedVertices.empty() ? vertices.size() * sizeof(Vertex) : packedVertices.size(); }
+};
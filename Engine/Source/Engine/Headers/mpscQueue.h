@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+// Unbounded lock-free queue for many producers and a single consumer (Vyukov's intrusive MPSC
+// design). Push never blocks, so worker threads can hand results to the GL thread without a lock.
+template <typename T>
+class MpscQueue
+{
+
+private:
+	struct Node {
+		std::atomic<Node*> next = nullptr;
+		std::optional<T> value;
+	};
+
+	std::atomic<Node*> m_head;
+	Node* m_tail;
+
+public:
+	MpscQueue()
+	{
+		Node* stub = new Node();
+		m_head.store(stub, std::memory_order_relaxed);
+		m_tail = stub;
+	}
+
+	~MpscQueue()
+	{
+		while (Pop()) {}
+		delete m_tail;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// Safe to call from any thread
+	void Push(T value)
+	{
+		Node* node = new Node();
+		node->value.emplace(std::move(value));
+		Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	// Consumer thread only. Returns nothing when the queue is empty or a push is still being linked in.
+	std::optional<T> Pop()
+	{
+		Node* tail = m_tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr) {
+			return std::nullopt;
+		}
+
+		std::optional<T> value = std::move(next->value);
+		next->value.reset();
+		m_tail = next;
+		delete tail;
+		return value;
+	}
+};
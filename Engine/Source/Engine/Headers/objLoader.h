@@ -1,32 +1,102 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
+#include <chrono>
+#include <future>
 #include <unordered_map>
 
 #include "shaderHelper.h"
 
 #include "modelPart.h"
 #include "material.h"
+#include "objParser.h"
+#include "meshImportOptions.h"
+#include "vfs.h"
+#include "meshCache.h"
 
 class ObjLoader
 {
 
+private:
+	struct PendingTexture {
+		std::string materialName;
+		std::string imagePath;
+	};
+
+	struct PendingBufferUpload {
+		GLuint buffer;
+		const unsigned char* data;
+		size_t size;
+		size_t offset;
+	};
+
 private:
 	std::string m_mtlFilePath;
 	std::string m_objFilePath;
+	MeshImportOptions m_options;
+
+	// Largest glBufferSubData issued per step of a budgeted upload
+	static constexpr size_t UPLOAD_SLICE_BYTES = 1 << 20;
+
+	// CPU results of the import, waiting for the GL thread
+	std::vector<PendingTexture> m_pendingTextures;
+	std::vector<std::future<void>> m_textureDecodes;
+	std::chrono::steady_clock::time_point m_textureDecodeStart;
+	std::unique_ptr<MeshCache> m_meshCache;
+	std::vector<std::vector<uint16_t>> m_shortIndices;
+	std::vector<PendingBufferUpload> m_pendingBuffers;
+	size_t m_uploadedTextures = 0;
+	bool m_materialsInterned = false;
+	size_t m_uploadedParts = 0;
+	size_t m_uploadedBuffers = 0;
+	bool m_isUploaded = false;
+	std::string m_error;
 
 public:
 	std::vector<GLuint> VAOS;
 	std::vector<GLuint> VBOS;
+	std::vector<GLuint> EBOS;
+	// Parsed MTL, keyed by material name; cleared by InternMaterials or DiscardMaterials
 	std::unordered_map<std::string, Material> MaterialData;
+	// MaterialTable references held by the model, one per material of its MTL
+	std::vector<MaterialId> MaterialIds;
 	std::vector<ModelPart> ModelParts;
 
 public:
-	ObjLoader(std::string objFilePath, std::string mtlFilePath);
+	// Parses the MTL/OBJ (or maps the baked cache) on the calling thread while the material textures
+	// decode in parallel on the shared ThreadPool; returns once both are done.
+	// Without `uploadNow` no GL call is made, so the import may run on a worker thread; streaming
+	// imports (MeshImportOptions::streamUpload) need `uploadNow` and fall back to a full load otherwise.
+	ObjLoader(std::string objFilePath, std::string mtlFilePath, const MeshImportOptions& options = MeshImportOptions(), bool uploadNow = true);
+
+	// GL thread only. Creates textures and buffers until `deadline` passes, always making some
+	// progress, and returns true once the whole model is on the GPU.
+	bool Upload(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+	bool IsUploaded() const { return m_isUploaded; }
+	// GL thread, after Upload. Interns the MTL's materials into the MaterialTable, filling MaterialIds
+	// and each part's materialId; interning replaces the shared rows of materials loaded before.
+	void InternMaterials();
+	// GL thread, instead of InternMaterials for an import that is thrown away: drops the texture
+	// references Upload acquired for the materials
+	void DiscardMaterials();
+	// Why the OBJ could not be imported, empty on success; a failed import has no parts and writes no cache
+	const std::string& Error() const { return m_error; }
 
 private:
+	bool OpenMeshCache();
+	void WriteMeshCache(const VfsFile& sourceFile);
 	void LoadObjFile();
+	void StreamObjFile();
+	bool BuildModelParts(ObjData& data);
+	void BuildIndexedGeometry(const ObjData& data, const ObjCorner* corners, size_t cornerCount, ModelPart& part);
+	void BuildLodChain(ModelPart& part);
+	void PackVertices();
+	void PackIndices();
 	void LoadMtlFile();
-	void LoadTexture(int& width, int& height, int& nrChannels, unsigned int& texture, const char* file, bool hasAlpha);
-	void SetupModelPartBuffers(const ModelPart& part, GLuint& VAO, GLuint& VBO);
+	void DecodeTextures();
+	void WaitForTextures();
+	void ReleaseImportData();
+	void CreatePartBuffers(size_t partIndex, bool uploadNow);
+	void UploadModelPart(VertexFormat vertexFormat, const void* vertexData, size_t vertexBytes, const void* indexData, size_t indexBytes, GLuint& VAO, GLuint& VBO, GLuint& EBO);
 };
\ No newline at end of file
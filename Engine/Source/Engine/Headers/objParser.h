@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm.hpp>
+
+// Zero-based indices into ObjData::positions/uvs/normals for one face corner
+struct ObjCorner {
+    uint32_t position;
+    uint32_t uv;
+    uint32_t normal;
+};
+
+// A run of faces sharing one material, in file order. Every `usemtl` starts a new range.
+struct ObjPartRange {
+    std::string materialName;
+    size_t firstFace = 0;
+    size_t faceCount = 0;
+};
+
+// Raw attribute pools and triangle corners of an OBJ file, exactly as they appear in the file
+struct ObjData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners; // 3 per face
+    std::vector<ObjPartRange> parts;
+
+    size_t FaceCount() const { return corners.size() / 3; }
+};
+
+// Line counts found by the pre-count pass, used to size every array exactly once
+struct ObjCounts {
+    size_t positions = 0;
+    size_t uvs = 0;
+    size_t normals = 0;
+    size_t faces = 0;
+    size_t materials = 0;
+    size_t lines = 0;
+};
+
+// Hand-written scanner for the subset of Wavefront OBJ produced by our exporters:
+// `v`, `vt`, `vn`, triangulated `f v/vt/vn` faces and `usemtl`. Everything else is skipped.
+class ObjParser
+{
+
+public:
+	// Files are only split when every chunk gets at least this much text
+	static constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+public:
+	static ObjCounts Count(const char* begin, const char* end);
+
+	// Splits the text at line boundaries into up to `chunkCount` chunks (0 = one per hardware thread)
+	// parsed on the shared ThreadPool. The result is identical for every chunk count.
+	static bool Parse(const char* begin, const char* end, ObjData& data, std::string& error, size_t chunkCount = 1);
+
+	// Streaming imports: like Parse, but leaves `data.corners` empty so only the attribute pools and
+	// the part ranges are kept in memory
+	static bool ParseAttributes(const char* begin, const char* end, ObjData& data, std::string& error, size_t chunkCount = 1);
+	// Sequential second pass for streaming imports. Calls `onFace` with the index of the part range (as
+	// reported by Parse/ParseAttributes) and the 3 corners of every face in file order; returning false stops.
+	static bool ForEachFace(const char* begin, const char* end, const std::function<bool(size_t, const ObjCorner*)>& onFace, std::string& error);
+
+private:
+	static bool Parse(const char* begin, const char* end, ObjData& data, std::string& error, size_t chunkCount, bool storeFaces);
+};
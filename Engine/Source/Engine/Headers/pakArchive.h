@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "mappedFile.h"
+
+enum class PakCompression : uint32_t {
+    None = 0, // stored 4K-aligned so the mapped entry can be used in place
+    Lz4 = 1   // LZ4 block, decompressed on open
+};
+
+struct PakHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+// Table of contents entry, sorted by pathHash then name
+struct PakEntry {
+    uint64_t pathHash;     // Hash::Fnv1a64 of the name
+    uint64_t offset;
+    uint64_t size;         // bytes stored in the archive
+    uint64_t originalSize;
+    uint64_t contentHash;  // Hash::Xxh64 of the original bytes
+    uint32_t nameOffset;   // into the name block
+    uint32_t nameLength;
+    uint32_t compression;  // PakCompression
+    uint32_t reserved;
+};
+
+struct PakWriteReport {
+    size_t entries = 0;
+    size_t compressedEntries = 0;
+    uint64_t originalBytes = 0;
+    uint64_t archiveBytes = 0;
+};
+
+// Read-only `.pak` archive: one open and one mapping for every asset inside it. Entry names are
+// '/'-separated paths relative to the directory the archive was built from.
+class PakArchive
+{
+
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint64_t ALIGNMENT = 4096;
+
+private:
+	MappedFile m_file;
+	const PakHeader* m_header = nullptr;
+	const PakEntry* m_entries = nullptr;
+
+public:
+	bool Open(const std::string& path);
+
+	bool IsOpen() const { return m_header != nullptr; }
+	size_t EntryCount() const { return m_header ? m_header->entryCount : 0; }
+	const PakEntry& Entry(size_t index) const { return m_entries[index]; }
+	const PakEntry* Find(std::string_view name) const;
+	std::string_view Name(const PakEntry& entry) const;
+	// Stored bytes of the entry, still compressed when entry.compression says so
+	const char* EntryData(const PakEntry& entry) const { return m_file.Data() + entry.offset; }
+};
+
+// Collects files and writes them into a `.pak`
+class PakWriter
+{
+
+private:
+	struct PendingEntry {
+		std::string name;
+		std::string sourcePath;
+		bool allowCompression = false;
+	};
+
+	std::vector<PendingEntry> m_pending;
+
+public:
+	// Entries are compressed only when `allowCompression` is set and LZ4 saves at least an eighth
+	void Add(const std::string& name, const std::string& sourcePath, bool allowCompression);
+	bool Write(const std::string& path, PakWriteReport& report) const;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm.hpp>
+
+#include "modelPart.h"
+#include "uniformBuffers.h"
+
+enum class RenderPass : uint8_t {
+    Opaque,      // sorted by state, then front to back
+    Transparent, // sorted back to front, then by state
+};
+
+// Everything Submit needs to issue one part's draw, resolved when the part is queued
+struct DrawPacket {
+    const ModelPart* part;
+    GLuint program;
+    GLuint instancedProgram; // the program's INSTANCED variant, 0 if there is none
+    GLuint vao;
+    GLuint texture;
+    int32_t layer;      // texture array layer, -1 for a 2D texture
+    uint32_t transform; // index of the model matrix added with AddTransform
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+struct RenderQueueStats {
+    size_t draws = 0;          // GL draw calls
+    size_t instancedDraws = 0;
+    size_t instances = 0;      // parts drawn by the instanced draws
+    size_t triangles = 0;
+    size_t programChanges = 0;
+    size_t vaoChanges = 0;
+    size_t textureChanges = 0;
+
+    size_t StateChanges() const { return programChanges + vaoChanges + textureChanges; }
+};
+
+// One frame's draws, each with a 64-bit sort key, radix-sorted before they are submitted so parts
+// sharing a program, texture and VAO are drawn back to back and opaque parts go front to back within
+// those groups. Runs of sorted draws of the same part, level of detail and material are merged into
+// one glDrawElementsInstanced reading their model matrices from a per-instance vertex buffer.
+// Opaque keys, from the top bit down:
+//
+//   pass 2 | layer 4 | program 8 | texture 12 | material 12 | vao 12 | depth 14
+//
+// Transparent keys move the inverted depth right after the layer. GL names wider than their field
+// wrap around, which only weakens grouping, never the order of passes and layers. GL thread only.
+class RenderQueue
+{
+
+public:
+	static constexpr uint32_t LAYER_COUNT = 16;
+	static constexpr uint32_t DEPTH_BITS = 14;
+	// First of the four attribute locations the instanced variant reads its model matrix from
+	static constexpr GLuint INSTANCE_LOCATION = 4;
+	// Shorter runs are drawn one by one, saving the switch to the instanced program
+	static constexpr size_t MIN_INSTANCES = 2;
+
+private:
+	struct SortEntry {
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	// Sorted entries [first, first + count), drawn with one instanced call when `instanced`
+	struct Batch {
+		size_t first;
+		size_t count;
+		bool instanced;
+		size_t firstInstance; // in m_instances
+	};
+
+	// What the last draw left bound
+	struct BoundState {
+		GLuint program = 0;
+		GLuint vao = 0;
+		GLuint texture = 0;
+		GLuint textureArray = 0;
+	};
+
+	std::vector<DrawPacket> m_packets;
+	std::vector<SortEntry> m_entries;
+	std::vector<SortEntry> m_scratch;
+	std::vector<glm::mat4> m_transforms;
+	// Third row of view * model per transform, giving a point's view-space depth with one dot product
+	std::vector<glm::vec4> m_depthRows;
+	std::vector<Batch> m_batches;
+	std::vector<glm::mat4> m_instances;
+	GLuint m_instanceBuffer = 0;
+	glm::mat4 m_view = glm::mat4(1.0f);
+	float m_farPlane = 100.0f;
+
+public:
+	RenderQueue() = default;
+	~RenderQueue();
+
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// Drops last frame's draws; depths are measured along `view` and quantized up to `farPlane`
+	void Begin(const glm::mat4& view, float farPlane);
+	uint32_t AddTransform(const glm::mat4& model);
+	// Queues `part` at its LOD `lodLevel`, keyed by the part's bounds center under `transform`
+	void Add(RenderPass pass, uint32_t layer, GLuint program, GLuint instancedProgram, const ModelPart& part, GLuint vao, uint32_t transform, unsigned int lodLevel);
+
+	void Sort();
+	// Issues the sorted draws, instancing runs of MIN_INSTANCES or more and skipping program, VAO and
+	// texture binds that would not change anything
+	RenderQueueStats Submit(UniformBuffers& uniforms);
+
+	size_t Size() const { return m_packets.size(); }
+
+	static uint64_t MakeKey(RenderPass pass, uint32_t layer, GLuint program, GLuint texture, MaterialId material, GLuint vao, uint32_t depth);
+
+private:
+	uint32_t QuantizeDepth(float depth) const;
+	void RadixSort();
+	void BuildBatches();
+	void UploadInstances();
+	void Bind(const DrawPacket& packet, GLuint program, BoundState& bound, RenderQueueStats& stats);
+	static bool SameDraw(const DrawPacket& a, const DrawPacket& b);
+};
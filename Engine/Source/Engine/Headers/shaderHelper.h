@@ -5,46 +5,58 @@
 #include <glm.hpp>
 
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 
+#include "hash.h"
+#include "vfs.h"
+
+// Name of a uniform or uniform block hashed at compile time: "model"_u
+struct UniformId
+{
+    uint64_t hash;
+};
+
+constexpr UniformId operator""_u(const char* name, size_t length)
+{
+    return { Hash::Fnv1a64(std::string_view(name, length)) };
+}
+
 class Shader
 {
 public:
     unsigned int ID;
 
+private:
+    // Active uniforms and uniform blocks, sorted by name hash
+    struct UniformSlot
+    {
+        uint64_t hash;
+        GLint location;
+    };
+    std::vector<UniformSlot> uniforms;
+    std::vector<UniformSlot> uniformBlocks;
+
+public:
+
+    // wraps a program linked elsewhere, e.g. by ShaderLibrary
+    // ------------------------------------------------------------------------
+    explicit Shader(unsigned int program) : ID(program)
+    {
+        reflect();
+    }
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
+        // 1. retrieve the vertex/fragment source code through the Vfs, so they can come from an archive
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
+        if (!Vfs::Shared().ReadText(vertexPath, vertexCode) || !Vfs::Shared().ReadText(fragmentPath, fragmentCode))
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << ", " << fragmentPath << std::endl;
         }
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
@@ -69,7 +81,7 @@ public:
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        reflect();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -77,7 +89,51 @@ public:
     {
         glUseProgram(ID);
     }
-    // utility uniform functions
+    // location of an active uniform, -1 (ignored by glUniform*) when the program has none by that name
+    // ------------------------------------------------------------------------
+    GLint location(UniformId id) const
+    {
+        return find(uniforms, id.hash);
+    }
+    // index of an active uniform block, -1 when there is none by that name
+    GLint blockIndex(UniformId id) const
+    {
+        return find(uniformBlocks, id.hash);
+    }
+    // utility uniform functions; the UniformId overloads skip the string and the driver round-trip
+    // ------------------------------------------------------------------------
+    void setBool(UniformId id, bool value) const
+    {
+        glUniform1i(location(id), (int)value);
+    }
+    void setInt(UniformId id, int value) const
+    {
+        glUniform1i(location(id), value);
+    }
+    void setFloat(UniformId id, float value) const
+    {
+        glUniform1f(location(id), value);
+    }
+    void setVec2(UniformId id, const glm::vec2& value) const
+    {
+        glUniform2fv(location(id), 1, &value[0]);
+    }
+    void setVec3(UniformId id, const glm::vec3& value) const
+    {
+        glUniform3fv(location(id), 1, &value[0]);
+    }
+    void setVec4(UniformId id, const glm::vec4& value) const
+    {
+        glUniform4fv(location(id), 1, &value[0]);
+    }
+    void setMat3(UniformId id, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(location(id), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformId id, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(location(id), 1, GL_FALSE, &mat[0][0]);
+    }
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
@@ -137,6 +193,77 @@ public:
     }
 
 private:
+    // builds the location tables from the linked program; arrays are found under their name without [0]
+    // ------------------------------------------------------------------------
+    void reflect()
+    {
+        uniforms.clear();
+        uniformBlocks.clear();
+        std::vector<std::string> uniformNames;
+        std::vector<std::string> blockNames;
+
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+            // members of uniform blocks have no location
+            GLint location = glGetUniformLocation(ID, name.data());
+            if (location < 0)
+                continue;
+            std::string_view uniformName(name.data(), length);
+            if (uniformName.size() > 3 && uniformName.substr(uniformName.size() - 3) == "[0]")
+                uniformName.remove_suffix(3);
+            uniforms.push_back({ Hash::Fnv1a64(uniformName), location });
+            uniformNames.emplace_back(uniformName);
+        }
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, (GLuint)i, (GLsizei)name.size(), &length, name.data());
+            uniformBlocks.push_back({ Hash::Fnv1a64(std::string_view(name.data(), length)), i });
+            blockNames.emplace_back(name.data(), length);
+        }
+
+#ifdef DEBUG
+        checkCollisions(uniforms, uniformNames, "uniform");
+        checkCollisions(uniformBlocks, blockNames, "uniform block");
+#endif
+        auto byHash = [](const UniformSlot& a, const UniformSlot& b) { return a.hash < b.hash; };
+        std::sort(uniforms.begin(), uniforms.end(), byHash);
+        std::sort(uniformBlocks.begin(), uniformBlocks.end(), byHash);
+    }
+    // ------------------------------------------------------------------------
+    static GLint find(const std::vector<UniformSlot>& slots, uint64_t hash)
+    {
+        auto slot = std::lower_bound(slots.begin(), slots.end(), hash, [](const UniformSlot& a, uint64_t h) { return a.hash < h; });
+        return slot != slots.end() && slot->hash == hash ? slot->location : -1;
+    }
+#ifdef DEBUG
+    // two names with one hash would silently share a location
+    // ------------------------------------------------------------------------
+    void checkCollisions(const std::vector<UniformSlot>& slots, const std::vector<std::string>& names, const char* kind) const
+    {
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            for (size_t j = i + 1; j < slots.size(); ++j)
+            {
+                if (slots[i].hash == slots[j].hash)
+                    std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION of " << kind << "s '" << names[i] << "' and '" << names[j] << "' in program " << ID << std::endl;
+            }
+        }
+    }
+#endif
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
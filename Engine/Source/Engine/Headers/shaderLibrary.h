@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+
+#include "shaderHelper.h"
+
+// Header of a `<hash>.glprog` file in the program binary cache, followed by the driver's binary
+struct ProgramBinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t driverHash;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+struct ShaderLibraryStats {
+    uint64_t requests = 0;
+    uint64_t programs = 0;
+    uint64_t compiled = 0;     // linked from GLSL
+    uint64_t binaryLoads = 0;  // restored from the binary cache
+    uint64_t binaryWrites = 0;
+    double milliseconds = 0.0; // spent building programs
+};
+
+// Every GL program the engine uses, built once per (vertex shader, fragment shader, defines) and shared
+// by every renderer asking for the same combination. With a binary cache directory set, linked programs
+// are saved with glGetProgramBinary, keyed by their preprocessed sources and the driver, so later runs
+// skip GLSL compilation. GL thread only.
+class ShaderLibrary
+{
+
+public:
+	static constexpr uint32_t BINARY_VERSION = 1;
+
+private:
+	// ARB_get_program_binary / GL 4.1; glad is generated for 3.3 core only
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+	std::unordered_map<std::string, std::shared_ptr<Shader>> m_shaders;
+	ShaderLibraryStats m_stats;
+
+	std::string m_binaryDirectory;
+	uint64_t m_driverHash = 0;
+	GetProgramBinaryProc m_getProgramBinary = nullptr;
+	ProgramBinaryProc m_programBinary = nullptr;
+	ProgramParameteriProc m_programParameteri = nullptr;
+
+public:
+	static ShaderLibrary& Shared();
+
+	// Stores linked programs under `directory` from now on. Returns false, leaving the cache off, when
+	// the driver cannot hand out program binaries. `getProcAddress` is the loader glad was given.
+	bool EnableBinaryCache(const std::string& directory, GLADloadproc getProcAddress);
+
+	// The program built from the two files with a `#define` line per entry of `defines` inserted after
+	// each `#version`. Null if the files cannot be read.
+	std::shared_ptr<Shader> Get(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+
+	size_t Count() const { return m_shaders.size(); }
+	const ShaderLibraryStats& Stats() const { return m_stats; }
+
+private:
+	static std::string InsertDefines(const std::string& source, const std::vector<std::string>& defines);
+	std::string BinaryPathFor(uint64_t sourceHash) const;
+	GLuint LoadBinary(uint64_t sourceHash);
+	void SaveBinary(GLuint program, uint64_t sourceHash);
+	GLuint Compile(const std::string& vertexSource, const std::string& fragmentSource, const std::string& name);
+	static bool CheckStatus(GLuint object, GLenum status, const std::string& what);
+};
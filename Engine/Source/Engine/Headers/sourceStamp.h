@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Identity of the source file a baked asset (.gmesh, .ktx) was built from
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t contentHash = 0;
+
+    // Fills in size and modification time; the content hash is left to callers that already read the file
+    static bool Describe(const std::string& sourcePath, SourceStamp& stamp);
+    // Size and modification time first, falling back to the content hash when only the timestamp moved.
+    // A match by content moves `stamp.modifiedTime` to the source's current time.
+    static bool Matches(const std::string& sourcePath, SourceStamp& stamp);
+    // Overwrites the modification time stored `offset` bytes into the baked file in place, so the
+    // next load of a touched but unchanged source skips the content hash
+    static bool StoreModifiedTime(const std::string& bakedPath, uint64_t offset, int64_t modifiedTime);
+};
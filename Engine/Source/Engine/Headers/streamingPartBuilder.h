@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "modelPart.h"
+#include "objParser.h"
+#include "vertexFormat.h"
+
+// Builds one model part straight into GL buffers while the OBJ is read. Vertices and indices are written
+// through glMapBufferRange one window at a time, and vertices are only deduplicated within the current
+// window, so the CPU never holds more than a window's worth of geometry. GL thread only.
+class StreamingPartBuilder
+{
+
+private:
+	struct DedupEntry {
+		ObjCorner corner;
+		uint32_t vertex = UINT32_MAX;
+	};
+
+	VertexFormat m_format;
+	PositionDequantization m_dequantization;
+	size_t m_stride;
+	size_t m_maxVertices;
+	size_t m_indexSize;
+	GLenum m_indexType;
+	size_t m_windowVertices;
+	size_t m_windowIndices;
+
+	GLuint m_vbo = 0;
+	GLuint m_ebo = 0;
+
+	size_t m_vertexCount = 0;
+	size_t m_vertexWindowEnd = 0;
+	unsigned char* m_vertexWindow = nullptr;
+	size_t m_vertexWindowStart = 0;
+
+	size_t m_indexCount = 0;
+	size_t m_indexWindowEnd = 0;
+	unsigned char* m_indexWindow = nullptr;
+	size_t m_indexWindowStart = 0;
+
+	std::vector<DedupEntry> m_dedup;
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+	double m_positionArea = 0.0;
+	double m_uvArea = 0.0;
+
+public:
+	// `faceCount` sizes the buffers; `windowBytes` bounds each mapped window and the dedup table
+	StreamingPartBuilder(size_t faceCount, VertexFormat format, const PositionDequantization& dequantization, size_t windowBytes);
+	~StreamingPartBuilder();
+
+	StreamingPartBuilder(const StreamingPartBuilder&) = delete;
+	StreamingPartBuilder& operator=(const StreamingPartBuilder&) = delete;
+
+	// Corners must already be validated against the pools of `data`. Returns false when the driver
+	// could not map the next window; the part is lost and the builder must not be used further.
+	bool AddTriangle(const ObjData& data, const ObjCorner* corners);
+
+	// Unmaps the last windows, trims the vertex buffer to what was written and hands the buffers and a
+	// VAO over to the caller. `part` receives the counts, format and bounds.
+	void Finish(ModelPart& part, GLuint& VAO, GLuint& VBO, GLuint& EBO);
+
+private:
+	bool AddVertex(const ObjData& data, const ObjCorner& corner, uint32_t& index);
+	bool MapVertexWindow();
+	bool MapIndexWindow();
+	static void Unmap(GLuint buffer, unsigned char*& window);
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "imageData.h"
+#include "ktxFile.h"
+#include "mpscQueue.h"
+
+// Sampler and format parameters baked into a GL texture; part of the cache key
+struct TextureSampler {
+    GLint wrap = GL_REPEAT;
+    GLint minFilter = GL_LINEAR_MIPMAP_NEAREST;
+    GLint magFilter = GL_NEAREST;
+    bool mipmaps = true;
+
+    bool operator==(const TextureSampler& other) const
+    {
+        return wrap == other.wrap && minFilter == other.minFilter && magFilter == other.magFilter && mipmaps == other.mipmaps;
+    }
+};
+
+// One image stored as a layer of a GL_TEXTURE_2D_ARRAY shared with other images of the same size and format
+struct TextureLayer {
+    GLuint texture = 0;
+    uint32_t layer = 0;
+
+    bool IsValid() const { return texture != 0; }
+};
+
+struct TextureCacheStats {
+    uint64_t requests = 0;
+    uint64_t hits = 0;
+    uint64_t decodes = 0;
+    uint64_t compressedTextures = 0; // uploaded from a baked .ktx
+    uint64_t residentTextures = 0;
+    uint64_t arrayTextures = 0; // GL_TEXTURE_2D_ARRAY pages
+    uint64_t arrayLayers = 0;   // images resident in them, also counted in residentTextures
+    uint64_t residentBytes = 0;
+    uint64_t savedBytes = 0; // decode and upload bytes avoided by hits
+
+    // Mip streaming, when a budget is set
+    uint64_t streamingBudget = 0;
+    uint64_t streamedTextures = 0; // textures whose finer levels come and go
+    uint64_t partialTextures = 0;  // of those, textures missing levels they had requested
+    uint64_t streamedInBytes = 0;
+    uint64_t evictedBytes = 0;
+
+    double HitRate() const { return requests ? static_cast<double>(hits) / requests : 0.0; }
+};
+
+// Engine-wide cache of GL textures keyed by resolved image path and sampler parameters. Each unique
+// texture is decoded once per process and shared by every material that references it. Textures are
+// either plain GL_TEXTURE_2Ds or layers of texture arrays, so materials drawn one after the other
+// need no rebinding as long as their images share a size and format.
+//
+// With a streaming budget set, mipmapped 2D textures start with only their smallest levels resident.
+// Renderers report each visible texture's on-screen texel density with RequestDetail, finer levels
+// are read on the thread pool and uploaded by UpdateStreaming, and the finest levels of the least
+// recently visible textures are evicted whenever resident bytes would exceed the budget.
+class TextureCache
+{
+
+private:
+	struct Entry {
+		std::string key;
+		std::string path;
+		TextureSampler sampler;
+		bool isLayer = false;
+		std::once_flag decoded;
+		ImageData image;
+		KtxFile baked; // preferred over `image` when a fresh <image>.ktx exists
+		std::vector<ImageData> chain; // mip levels of `image` for layers and streamed textures, uploaded level by level
+		GLuint texture = 0; // the array for layers
+		uint32_t layer = 0;
+		uint32_t refCount = 0;
+		uint32_t pins = 0; // Prefetch/Acquire calls working on the entry outside m_mutex; Trim skips it
+		uint64_t bytes = 0;
+
+		// Streaming state, GL thread only. Levels residentBase and coarser are uploaded.
+		bool streamed = false;
+		bool streaming = false; // finer levels are being read
+		int width = 0;
+		int height = 0;
+		std::vector<uint64_t> levelBytes;
+		size_t tailBase = 0; // first level small enough to never be evicted
+		size_t residentBase = 0;
+		size_t wantedBase = 0; // finest level asked for in lastVisibleFrame
+		uint64_t lastVisibleFrame = 0;
+	};
+
+	// A changed image decoded on the thread pool, waiting to replace the contents of a resident texture
+	struct PendingReload {
+		std::string key;
+		ImageData image;
+		KtxFile baked;
+		std::vector<ImageData> chain;
+		std::chrono::steady_clock::time_point changed;
+	};
+
+	// Texture array holding every layer of one size, format, level count and sampler
+	struct ArrayPage {
+		GLuint texture = 0;
+		GLenum internalFormat = 0;
+		int width = 0;
+		int height = 0;
+		size_t levels = 0;
+		TextureSampler sampler;
+		uint32_t capacity = 0;
+		std::vector<uint32_t> freeLayers;
+		uint64_t layerBytes = 0;
+	};
+
+	// Finer levels of a streamed texture read on the thread pool
+	struct PendingStream {
+		std::string key;
+		size_t firstLevel = 0;
+		KtxFile baked;
+		std::vector<ImageData> chain;
+	};
+
+	// Levels of one image ready for upload; glType 0 means block compressed
+	struct MipLevels {
+		GLenum internalFormat = 0;
+		GLenum glFormat = 0;
+		GLenum glType = 0;
+		std::vector<KtxLevel> levels;
+		std::vector<std::vector<unsigned char>> storage; // levels decoded on the CPU
+		uint64_t bytes = 0;
+	};
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, std::unique_ptr<Entry>> m_entries;
+	std::unordered_map<GLuint, Entry*> m_entriesByTexture;
+	std::unordered_map<uint64_t, Entry*> m_entriesByLayer; // array name << 32 | layer
+	std::vector<std::unique_ptr<ArrayPage>> m_arrayPages;
+	TextureCacheStats m_stats;
+	std::shared_ptr<MpscQueue<PendingReload>> m_reloads = std::make_shared<MpscQueue<PendingReload>>();
+
+	std::atomic<uint64_t> m_streamingBudget = 0;
+	std::vector<Entry*> m_streamedEntries;
+	uint64_t m_frame = 1;
+	std::shared_ptr<MpscQueue<PendingStream>> m_streams = std::make_shared<MpscQueue<PendingStream>>();
+
+public:
+	static TextureCache& Shared();
+
+	// Layers of one array page are allocated up front, as many as fit this size (4 to 64)
+	static constexpr uint64_t ARRAY_PAGE_BYTES = 16 << 20;
+	// Levels this size and smaller stay resident once a streamed texture is uploaded
+	static constexpr int STREAMING_TAIL_SIZE = 64;
+
+	// Any thread: decodes the image ahead of its upload unless it is already decoded or resident.
+	// `asLayer` prepares it for AcquireLayer instead of Acquire.
+	void Prefetch(const std::string& imagePath, const TextureSampler& sampler = TextureSampler(), bool asLayer = false);
+	// GL thread: returns a new reference to the texture, uploading it on first use (0 if it cannot be decoded)
+	GLuint Acquire(const std::string& imagePath, const TextureSampler& sampler = TextureSampler());
+	// GL thread: as Acquire, but places the image in a layer of a texture array shared with images of the
+	// same size, format and sampler (an invalid layer if it cannot be decoded)
+	TextureLayer AcquireLayer(const std::string& imagePath, const TextureSampler& sampler = TextureSampler());
+	// GL thread: drops a reference. Unreferenced textures stay resident for later hits until Trim.
+	void Release(GLuint texture);
+	void Release(const TextureLayer& layer);
+	// GL thread: deletes every texture nobody references, drops images decoded by Prefetch but never
+	// acquired, and deletes every array page left empty
+	void Trim();
+
+	// Any thread: re-decodes every resident texture built from `changedPath` (an image or its baked .ktx)
+	// on the thread pool and returns how many. Returns 0 for files no texture was made from.
+	size_t Reload(const std::string& changedPath, std::chrono::steady_clock::time_point changed = std::chrono::steady_clock::now());
+	// GL thread: replaces the contents of reloaded textures in place, so every material keeps its texture name
+	void ProcessReloads();
+
+	// Caps resident texture bytes and streams the levels of mipmapped 2D textures acquired from then on;
+	// 0 (the default) uploads every level up front. Set it before loading the scene.
+	void SetStreamingBudget(uint64_t bytes);
+	// GL thread: `texture` is drawn this frame at `uvPerPixel` texture coordinate units per screen pixel
+	void RequestDetail(GLuint texture, float uvPerPixel);
+	// GL thread, once per frame after drawing: uploads streamed-in levels, starts reads for the levels
+	// requested this frame and evicts to stay within the budget
+	void UpdateStreaming();
+
+	TextureCacheStats Stats() const;
+
+private:
+	// Keeps an entry found by FindOrCreate alive until the end of the scope
+	class EntryPin
+	{
+	public:
+		EntryPin(TextureCache& cache, Entry& entry) : m_cache(cache), m_entry(entry) {}
+		~EntryPin();
+		EntryPin(const EntryPin&) = delete;
+		EntryPin& operator=(const EntryPin&) = delete;
+
+	private:
+		TextureCache& m_cache;
+		Entry& m_entry;
+	};
+
+	// Returns the entry already pinned; the caller hands it to an EntryPin
+	Entry& FindOrCreate(const std::string& imagePath, const TextureSampler& sampler, bool asLayer);
+	void Decode(Entry& entry);
+	// Loose images are decoded into `chain` instead of `image` when `withChain` is set
+	static void DecodeImage(const std::string& path, bool withChain, ImageData& image, KtxFile& baked, std::vector<ImageData>& chain);
+	static std::string MakeKey(const std::string& resolvedPath, const TextureSampler& sampler, bool asLayer);
+	static uint64_t LayerKey(GLuint texture, uint32_t layer) { return (static_cast<uint64_t>(texture) << 32) | layer; }
+	static bool PrepareLevels(const KtxFile& baked, const std::vector<ImageData>& chain, const TextureSampler& sampler, MipLevels& levels);
+	// Returns a free layer of a matching page, creating the page when every match is full
+	ArrayPage* AllocateLayer(const MipLevels& image, const TextureSampler& sampler, uint32_t& layer);
+	ArrayPage* FindPage(GLuint texture);
+	static void UploadLayer(const ArrayPage& page, uint32_t layer, const MipLevels& image);
+	// Uploads the resident levels of a streamed texture, only its tail when it is new or changed shape,
+	// and returns their bytes
+	static uint64_t UploadStreamed(Entry& entry, GLuint texture, const MipLevels& levels);
+	static void UploadLevels(GLuint texture, const MipLevels& levels, size_t first, size_t end);
+	// Drops the finest resident level; the caller holds m_mutex
+	void EvictLevel(Entry& entry);
+	// Evicts levels of textures not needing them, least recently visible first, until `bytes` more fit
+	// the budget. Never touches `keep`. Returns false if they still do not fit.
+	bool MakeRoom(uint64_t bytes, const Entry* keep);
+	// Both create a texture unless given one to respecify
+	static GLuint Upload(const ImageData& image, const TextureSampler& sampler, GLuint texture = 0);
+	static GLuint Upload(const KtxFile& baked, const TextureSampler& sampler, uint64_t& bytes, GLuint texture = 0);
+	static bool SupportsS3tc();
+};
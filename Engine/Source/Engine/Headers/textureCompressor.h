@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "blockCompression.h"
+#include "imageData.h"
+#include "mipGenerator.h"
+
+struct TextureBakeReport {
+    BlockFormat format = BlockFormat::BC1;
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+    uint64_t uncompressedBytes = 0; // RGBA8 with the same mip chain
+    uint64_t compressedBytes = 0;
+    BlockCompressionError error; // base level, decoded back and diffed against the source
+};
+
+// Offline step that turns a JPEG/PNG into a block-compressed `<image>.ktx` with a full mip chain.
+// TextureCache picks the baked file up instead of decoding the image when it is still fresh.
+class TextureCompressor
+{
+
+public:
+	static std::string CompressedPathFor(const std::string& imagePath);
+	// BC3 when any texel is not fully opaque, BC1 otherwise. BC5 (normal maps) is only used on request.
+	static BlockFormat ChooseFormat(const ImageData& image);
+
+	static bool Bake(const std::string& imagePath, TextureBakeReport& report, const MipOptions& mipOptions = MipOptions());
+	// Linear sources (masks, roughness) pass MipOptions::gammaCorrect = false; BC5 always filters linearly
+	static bool Bake(const std::string& imagePath, BlockFormat format, TextureBakeReport& report, const MipOptions& mipOptions = MipOptions());
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size pool of worker threads. Workers that wait on pool work help run queued tasks, so jobs
+// may safely submit and wait on sub-jobs. Other threads, the GL thread above all, never pick up queued
+// tasks: a frame must not end up running someone else's model import.
+class ThreadPool
+{
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+
+public:
+	explicit ThreadPool(size_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Engine-wide pool with one worker per hardware thread besides the caller (at least one)
+	static ThreadPool& Shared();
+
+	size_t ThreadCount() const { return m_workers.size(); }
+
+	template <typename Function>
+	auto Submit(Function&& function) -> std::future<std::invoke_result_t<std::decay_t<Function>>>
+	{
+		using Result = std::invoke_result_t<std::decay_t<Function>>;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+		std::future<Result> future = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.emplace_back([task]() { (*task)(); });
+		}
+		m_condition.notify_one();
+		return future;
+	}
+
+	// True on the worker threads of any pool
+	static bool IsWorkerThread();
+
+	// Workers run queued tasks until `future` is ready; any other thread blocks on it
+	template <typename Result>
+	Result WaitFor(std::future<Result>& future)
+	{
+		if (!IsWorkerThread()) {
+			return future.get();
+		}
+		while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			if (!RunPendingTask()) {
+				future.wait_for(std::chrono::microseconds(100));
+			}
+		}
+		return future.get();
+	}
+
+	// Calls function(i) for every i in [0, count), spread over the workers and the calling thread.
+	// Helpers still queued once the caller has run out of indices are skipped, so the caller only waits
+	// for helpers already running, never behind unrelated tasks.
+	template <typename Function>
+	void ParallelFor(size_t count, Function&& function)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		// Outlives the call for helpers that start after it returned; they find it closed
+		struct Progress {
+			std::atomic<size_t> next = 0;
+			std::mutex mutex;
+			std::condition_variable finished;
+			size_t running = 0;
+			bool closed = false;
+		};
+		auto progress = std::make_shared<Progress>();
+		auto body = [progress, count, &function]() {
+			for (size_t i = progress->next.fetch_add(1); i < count; i = progress->next.fetch_add(1)) {
+				function(i);
+			}
+		};
+
+		size_t helperCount = std::min(count - 1, ThreadCount());
+		for (size_t i = 0; i < helperCount; ++i) {
+			Submit([progress, body]() {
+				{
+					std::lock_guard<std::mutex> lock(progress->mutex);
+					if (progress->closed) {
+						return;
+					}
+					progress->running++;
+				}
+				body();
+				{
+					std::lock_guard<std::mutex> lock(progress->mutex);
+					progress->running--;
+				}
+				progress->finished.notify_all();
+			});
+		}
+
+		body();
+
+		std::unique_lock<std::mutex> lock(progress->mutex);
+		progress->closed = true;
+		progress->finished.wait(lock, [&]() { return progress->running == 0; });
+	}
+
+private:
+	bool RunPendingTask();
+	void WorkerLoop();
+};
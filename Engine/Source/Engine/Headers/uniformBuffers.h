@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm.hpp>
+
+class Shader;
+
+// std140 mirrors of the uniform blocks declared by the shaders. Every member is 16-byte aligned so the
+// C++ and GLSL layouts agree without explicit padding rules.
+
+// Once per frame
+struct FrameUniforms {
+    glm::vec4 screenSize; // width, height, 1 / width, 1 / height
+    float time = 0.0f;
+    float deltaTime = 0.0f;
+    uint32_t frameIndex = 0;
+    uint32_t reserved = 0;
+};
+
+// Once per camera
+struct ViewUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+};
+
+// Once per draw, in its own range of a ring buffer
+struct DrawUniforms {
+    glm::mat4 model;
+    glm::vec4 positionScale;  // dequantization of the part's positions, w unused
+    glm::vec4 positionOffset;
+    glm::ivec4 material;      // x: texture array layer, -1 for a 2D texture
+};
+
+struct UniformBufferStats {
+    size_t uploads = 0;    // glBufferSubData calls
+    size_t bytes = 0;
+    size_t rangeBinds = 0; // per-draw glBindBufferRange calls
+};
+
+// The frame, view and draw uniform buffers, bound at fixed binding points shared by every program.
+// Draws write their block to the next slot of a ring sized to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT and
+// bind that range, so a draw costs one small upload instead of a glUniform call per value. GL thread only.
+class UniformBuffers
+{
+
+public:
+	static constexpr GLuint FRAME_BINDING = 0;
+	static constexpr GLuint VIEW_BINDING = 1;
+	static constexpr GLuint DRAW_BINDING = 2;
+	// Draw slots before the ring buffer is orphaned and reused
+	static constexpr size_t DRAW_SLOTS = 4096;
+
+private:
+	GLuint m_frameBuffer = 0;
+	GLuint m_viewBuffer = 0;
+	GLuint m_drawBuffer = 0;
+	size_t m_drawStride = 0;
+	size_t m_drawCursor = 0;
+	UniformBufferStats m_stats;
+
+public:
+	UniformBuffers() = default;
+	~UniformBuffers();
+
+	UniformBuffers(const UniformBuffers&) = delete;
+	UniformBuffers& operator=(const UniformBuffers&) = delete;
+
+	// Uploads the frame block and starts counting the frame's uploads again
+	void BeginFrame(const FrameUniforms& frame);
+	void SetView(const ViewUniforms& view);
+	// Uploads the block of the next draw and binds it at DRAW_BINDING
+	void PushDraw(const DrawUniforms& draw);
+
+	// Points the program's FrameUniforms, ViewUniforms and DrawUniforms blocks at the fixed binding points
+	static void AssignBindings(const Shader& shader);
+
+	// Since the last BeginFrame
+	const UniformBufferStats& Stats() const { return m_stats; }
+
+private:
+	void Create();
+	void Upload(GLuint buffer, size_t offset, const void* data, size_t size);
+};
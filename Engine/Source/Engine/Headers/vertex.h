@@ -0,0 +1,12 @@
+#pragma once
+
+#include <glm.hpp>
+
+// Interleaved layout uploaded to the GPU: position (3 floats), uv (2 floats), normal (3 floats)
+struct Vertex {
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+};
+
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must stay tightly packed");
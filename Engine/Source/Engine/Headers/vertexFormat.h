@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm.hpp>
+
+#include "vertex.h"
+
+// GPU vertex layouts a model can be uploaded with
+enum class VertexFormat : uint32_t {
+    Float32 = 0,          // 32 bytes: float3 position, float2 uv, float3 normal
+    Compact = 1,          // 20 bytes: float3 position, half2 uv, 2_10_10_10 normal
+    CompactQuantized = 2  // 16 bytes: snorm16x3 position dequantized by the part bounds, half2 uv, 2_10_10_10 normal
+};
+
+// Per-part transform from stored to object-space positions: position = stored * scale + offset
+struct PositionDequantization {
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// Worst and mean differences between the original vertices and what the GPU will see
+struct VertexQuantizationError {
+    float maxPosition = 0.0f;
+    double meanPosition = 0.0;
+    float maxNormalDegrees = 0.0f;
+    float maxUv = 0.0f;
+};
+
+namespace VertexFormats {
+
+	size_t Stride(VertexFormat format);
+	PositionDequantization Dequantization(VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	std::vector<unsigned char> Pack(VertexFormat format, const std::vector<Vertex>& vertices, const PositionDequantization& dequantization);
+	// Writes Stride(format) bytes to `target`, which need not be aligned
+	void PackVertex(VertexFormat format, const Vertex& vertex, const PositionDequantization& dequantization, unsigned char* target);
+	Vertex Unpack(VertexFormat format, const unsigned char* packed, const PositionDequantization& dequantization);
+	VertexQuantizationError MeasureError(VertexFormat format, const std::vector<Vertex>& vertices, const std::vector<unsigned char>& packed, const PositionDequantization& dequantization);
+
+	// Points attributes 0 (position), 1 (uv) and 2 (normal) of the bound VAO at the bound GL_ARRAY_BUFFER
+	void SetupAttributes(VertexFormat format);
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "mappedFile.h"
+#include "pakArchive.h"
+
+// Read-only view of an asset, wherever it came from: a mapped loose file, an uncompressed entry
+// used in place inside a mounted archive, or a decompressed copy of a compressed one
+class VfsFile
+{
+
+	friend class Vfs;
+
+private:
+	MappedFile m_mapped;
+	std::vector<char> m_buffer;
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_isOpen = false;
+	bool m_isArchived = false;
+
+public:
+	VfsFile() = default;
+	explicit VfsFile(const std::string& path);
+
+	VfsFile(const VfsFile&) = delete;
+	VfsFile& operator=(const VfsFile&) = delete;
+	VfsFile(VfsFile&& other) noexcept;
+	VfsFile& operator=(VfsFile&& other) noexcept;
+
+	// Opens through Vfs::Shared()
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_isOpen; }
+	bool IsArchived() const { return m_isArchived; }
+	const char* Data() const { return m_data; }
+	const char* End() const { return m_data + m_size; }
+	size_t Size() const { return m_size; }
+};
+
+struct VfsStats {
+    uint32_t archivedOpens = 0;
+    uint32_t decompressedOpens = 0;
+    uint32_t looseOpens = 0;
+    uint64_t decompressedBytes = 0;
+};
+
+// Engine-wide file lookup. Mounted archives are searched first, newest mount first, then the disk,
+// so loose files keep working during development and a shipped build reads everything from one `.pak`.
+// Paths are the ones the engine already uses ("../Engine/Source/Engine/Models/rose.obj").
+class Vfs
+{
+
+private:
+	struct MountedArchive {
+		std::string root; // Normalize()d directory the archive's entry names are relative to
+		PakArchive archive;
+	};
+
+	std::vector<std::unique_ptr<MountedArchive>> m_mounts;
+	mutable std::shared_mutex m_mutex;
+
+	mutable std::atomic<uint32_t> m_archivedOpens = 0;
+	mutable std::atomic<uint32_t> m_decompressedOpens = 0;
+	mutable std::atomic<uint32_t> m_looseOpens = 0;
+	mutable std::atomic<uint64_t> m_decompressedBytes = 0;
+
+public:
+	static Vfs& Shared();
+
+	// Absolute, lexically normal, '/'-separated
+	static std::string Normalize(const std::string& path);
+
+	// Entries of `archivePath` become visible under `rootDirectory`
+	bool Mount(const std::string& archivePath, const std::string& rootDirectory);
+	size_t MountCount() const;
+
+	bool Open(const std::string& path, VfsFile& file) const;
+	bool ReadText(const std::string& path, std::string& text) const;
+	bool Exists(const std::string& path) const;
+	// Content hash recorded when the file was packed; false for files that are not archived
+	bool ArchivedContentHash(const std::string& path, uint64_t& contentHash, uint64_t& size) const;
+
+	VfsStats Stats() const;
+
+private:
+	const PakEntry* FindArchived(const std::string& path, const PakArchive*& archive) const;
+};
@@ -1,12 +1,13 @@
 #include "Headers/ECS/Components/MeshRenderer.h"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
 
-#include "material.h"
 #include "globals.h"
 #include "shaderHelper.h"
+#include "shaderLibrary.h"
 
-MeshRenderer::MeshRenderer(int entityId) : shader(nullptr)
+MeshRenderer::MeshRenderer(int entityId, MeshHandle mesh) : Mesh(mesh), shader(nullptr), instancedShader(nullptr)
 {
     EntityID = entityId;
     SetShader();
@@ -14,47 +15,65 @@ MeshRenderer::MeshRenderer(int entityId) : shader(nullptr)
 
 void MeshRenderer::SetShader()
 {
-    std::unique_ptr<Shader> s = std::make_unique<Shader>("../Engine/Source/Engine/modelShader.vs", "../Engine/Source/Engine/modelShader.fs");
-    shader = std::move(s);
+    shader = ShaderLibrary::Shared().Get("../Engine/Source/Engine/modelShader.vs", "../Engine/Source/Engine/modelShader.fs");
+    instancedShader = ShaderLibrary::Shared().Get("../Engine/Source/Engine/modelShader.vs", "../Engine/Source/Engine/modelShader.fs", { "INSTANCED" });
+    // Texture units never change; everything else comes from the uniform buffers
+    for (Shader* program : { shader.get(), instancedShader.get() }) {
+        if (program) {
+            program->use();
+            program->setInt("texture1"_u, 0);
+            program->setInt("textureArray"_u, 1);
+        }
+    }
 }
 
-void MeshRenderer::Render(Camera camera, glm::mat4 modelMatrix) {
-
-    if (!shader) {
-        std::cerr << "Shader is null!" << std::endl;
-        return;
-    }
+void MeshRenderer::SelectLods(const MeshAsset& mesh, float pixelsPerUnit, float maxPixelError, float hysteresis) {
+    LodLevels.resize(mesh.ModelParts.size(), 0);
 
-    shader->use();
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera.GetViewMatrix();
-    glm::mat4 model = modelMatrix;
-    model = glm::rotate(model, glm::radians(50.0f) * (float)glfwGetTime(), glm::vec3(0.5f, 1.0f, 0.0f));
+    for (size_t i = 0; i < mesh.ModelParts.size(); ++i) {
+        const std::vector<ModelLod>& lods = mesh.ModelParts[i].lods;
+        unsigned int& current = LodLevels[i];
+        if (lods.empty()) {
+            current = 0;
+            continue;
+        }
+        current = std::min<unsigned int>(current, static_cast<unsigned int>(lods.size() - 1));
 
-    shader->setMat4("projection", projection);
-    shader->setMat4("view", view);
-    shader->setMat4("model", model);
+        // Coarsest level allowed at all, and coarsest level allowed to switch down to
+        unsigned int allowed = 0;
+        unsigned int switchable = 0;
+        for (unsigned int level = 1; level < lods.size(); ++level) {
+            float pixels = lods[level].error * pixelsPerUnit;
+            if (pixels <= maxPixelError) {
+                allowed = level;
+            }
+            if (pixels <= maxPixelError * (1.0f - hysteresis)) {
+                switchable = level;
+            }
+        }
 
-    int index = 0;
-    for (const auto& part : ModelParts) {
-        RenderModelPart(part, VAOS[index]);
-        index++;
+        if (current > allowed) {
+            current = allowed;
+        }
+        else if (current < switchable) {
+            current = switchable;
+        }
     }
 }
 
-void MeshRenderer::RenderModelPart(const ModelPart& part, GLuint vao) {
-    glBindVertexArray(vao);
+void MeshRenderer::Enqueue(const glm::mat4& modelMatrix, const MeshAsset& mesh, RenderQueue& queue) {
 
-    auto it = MaterialData.find(part.materialName);
-    if (it != MaterialData.end()) {
-        const Material& material = it->second;
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, material.textureID);
-        shader->setInt("texture1", 0);
+    if (!shader) {
+        std::cerr << "Shader is null!" << std::endl;
+        return;
     }
 
-    glDrawArrays(GL_TRIANGLES, 0, part.vertexCount);
+    glm::mat4 model = glm::rotate(modelMatrix, glm::radians(50.0f) * (float)glfwGetTime(), glm::vec3(0.5f, 1.0f, 0.0f));
+    uint32_t transform = queue.AddTransform(model);
+    GLuint instancedProgram = instancedShader ? instancedShader->ID : 0;
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
+    for (size_t i = 0; i < mesh.ModelParts.size(); ++i) {
+        unsigned int lodLevel = i < LodLevels.size() ? LodLevels[i] : 0;
+        queue.Add(RenderPass::Opaque, Layer, shader->ID, instancedProgram, mesh.ModelParts[i], mesh.VAOS[i], transform, lodLevel);
+    }
 }
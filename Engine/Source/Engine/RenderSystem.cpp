@@ -1,12 +1,72 @@
 #include "Headers/ECS/Systems/RenderSystem.h"
-#include "objLoader.h"
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <iostream>
+
+#include "engineLog.h"
+#include "globals.h"
+#include "materialTable.h"
+#include "textureCache.h"
 
 RenderSystem::RenderSystem(std::map<int, std::shared_ptr<Transform>>& transforms, std::map<int, std::shared_ptr<MeshRenderer>>& meshRenderers)
 	: transforms(transforms), meshRenderers(meshRenderers) {}
 
+void RenderSystem::WatchAssets(const std::vector<std::string>& directories)
+{
+	m_assetWatcher.reset();
+	if (!directories.empty()) {
+		m_assetWatcher = std::make_unique<FileWatcher>(directories);
+	}
+}
+
+void RenderSystem::ReloadChangedAssets()
+{
+	if (m_assetWatcher) {
+		for (const FileChange& change : m_assetWatcher->PollChanges()) {
+			size_t meshes = MeshAssets.Reload(change.path, change.detected);
+			size_t textures = TextureCache::Shared().Reload(change.path, change.detected);
+			if (meshes + textures > 0 && EngineLog::Verbose) {
+				std::cout << "'" << change.path << "' changed, reloading " << meshes << " meshes and " << textures << " textures\n";
+			}
+		}
+	}
+
+	TextureCache::Shared().ProcessReloads();
+}
+
 void RenderSystem::Render(Camera camera)
 {
+	ReloadChangedAssets();
+	MeshAssets.ProcessUploads(UploadBudgetMilliseconds);
+
+	FrameUniforms frame;
+	frame.screenSize = glm::vec4((float)SCR_WIDTH, (float)SCR_HEIGHT, 1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT);
+	frame.time = (float)glfwGetTime();
+	frame.deltaTime = m_frameIndex == 0 ? 0.0f : frame.time - m_lastFrameTime;
+	frame.frameIndex = m_frameIndex++;
+	m_lastFrameTime = frame.time;
+	m_uniforms.BeginFrame(frame);
+
+	ViewUniforms view;
+	view.projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+	view.view = camera.GetViewMatrix();
+	view.viewProjection = view.projection * view.view;
+	view.cameraPosition = glm::vec4(camera.Position, 1.0f);
+	m_uniforms.SetView(view);
+	m_queue.Begin(view.view, FAR_PLANE);
+
+	RenderStats stats;
+	stats.lodPixelError = LodPixelError * m_lodErrorScale;
+	// Pixels covered by one object-space unit at distance 1, matching the view's projection
+	float pixelsPerUnitAtOne = (SCR_HEIGHT * 0.5f) / std::tan(glm::radians(camera.Zoom) * 0.5f);
+
 	for (auto& meshRenderer : meshRenderers) {
+		const MeshAsset* mesh = MeshAssets.Get(meshRenderer.second->Mesh);
+		if (!mesh || !mesh->IsLoaded) {
+			continue;
+		}
+
 		auto transform = transforms.find(meshRenderer.first);
 
 		glm::mat4 model = glm::mat4(1.0f);
@@ -14,37 +74,74 @@ void RenderSystem::Render(Camera camera)
 			model = transform->second->GetModelMatrix();
 		}
 
-		meshRenderer.second->Render(camera, model);
+		// Project from the nearest point of the bounding sphere so large meshes are not coarsened early
+		glm::vec3 center = glm::vec3(model * glm::vec4((mesh->BoundsMin + mesh->BoundsMax) * 0.5f, 1.0f));
+		float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+		float radius = glm::length(mesh->BoundsMax - mesh->BoundsMin) * 0.5f * scale;
+		float distance = std::max(glm::length(center - camera.Position) - radius, 0.1f);
+
+		float pixelsPerUnit = pixelsPerUnitAtOne * scale / distance;
+		meshRenderer.second->SelectLods(*mesh, pixelsPerUnit, stats.lodPixelError, LodHysteresis);
+		RequestTextureDetail(*mesh, pixelsPerUnit);
+		meshRenderer.second->Enqueue(model, *mesh, m_queue);
+		stats.drawnMeshes++;
 	}
+
+	m_queue.Sort();
+	RenderQueueStats submitted = m_queue.Submit(m_uniforms);
+	stats.drawCalls = submitted.draws;
+	stats.instancedDraws = submitted.instancedDraws;
+	stats.instances = submitted.instances;
+	stats.triangles = submitted.triangles;
+	stats.stateChanges = submitted.StateChanges();
+
+	// Trade detail for a steady triangle count as objects are added
+	if (TriangleBudget > 0) {
+		if (stats.triangles > TriangleBudget) {
+			m_lodErrorScale = std::min(m_lodErrorScale * 1.25f, MAX_LOD_ERROR_SCALE);
+		}
+		else if (stats.triangles < TriangleBudget * 3 / 4) {
+			m_lodErrorScale = std::max(m_lodErrorScale / 1.25f, 1.0f);
+		}
+	}
+
+	TextureCache::Shared().UpdateStreaming();
+	stats.uniformUploads = m_uniforms.Stats().uploads;
+	LastFrame = stats;
 }
 
-void RenderSystem::RemoveRenderable(int entityId)
+void RenderSystem::RequestTextureDetail(const MeshAsset& mesh, float pixelsPerUnit)
 {
-	auto meshRenderer = meshRenderers[entityId];
-
-	for (auto vao : meshRenderer->VAOS) {
-		glDeleteVertexArrays(1, &vao);
+	const MaterialTable& materials = MaterialTable::Shared();
+	for (const ModelPart& part : mesh.ModelParts) {
+		if (part.materialId != INVALID_MATERIAL && materials.Layer(part.materialId) < 0) {
+			TextureCache::Shared().RequestDetail(materials.Texture(part.materialId), part.uvDensity / pixelsPerUnit);
+		}
 	}
+}
 
-	for (auto vbo : meshRenderer->VBOS) {
-		glDeleteBuffers(1, &vbo);
+void RenderSystem::RemoveRenderable(int entityId)
+{
+	auto meshRenderer = meshRenderers.find(entityId);
+	if (meshRenderer == meshRenderers.end()) {
+		return;
 	}
 
-	meshRenderer->VAOS.clear();
-	meshRenderer->VBOS.clear();
-	meshRenderer->ModelParts.clear();
-	meshRenderer->MaterialData.clear();
-	meshRenderers.erase(entityId);
+	MeshAssets.Release(meshRenderer->second->Mesh);
+	meshRenderers.erase(meshRenderer);
 }
 
 void RenderSystem::AddNewRenderable(int entityId, std::string objFilePath, std::string mtlFilePath)
 {
-	ObjLoader objLoader(objFilePath, mtlFilePath);
-	auto meshRenderer = std::make_shared<MeshRenderer>(entityId);
-	meshRenderer->VAOS = objLoader.VAOS;
-	meshRenderer->VBOS = objLoader.VBOS;
-	meshRenderer->ModelParts = objLoader.ModelParts;
-	meshRenderer->MaterialData = objLoader.MaterialData;
-
-	meshRenderers[entityId] = meshRenderer;
+	// Acquired before the old mesh is released, so re-adding the same model to an entity never reimports it
+	MeshHandle mesh = MeshAssets.Acquire(objFilePath, mtlFilePath, false);
+	RemoveRenderable(entityId);
+	meshRenderers[entityId] = std::make_shared<MeshRenderer>(entityId, mesh);
+}
+
+void RenderSystem::AddNewRenderableAsync(int entityId, std::string objFilePath, std::string mtlFilePath)
+{
+	MeshHandle mesh = MeshAssets.Acquire(objFilePath, mtlFilePath, true);
+	RemoveRenderable(entityId);
+	meshRenderers[entityId] = std::make_shared<MeshRenderer>(entityId, mesh);
 }
@@ -0,0 +1,426 @@
+#include "blockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm.hpp>
+
+namespace {
+
+    struct Block {
+        uint8_t texels[16][4];
+    };
+
+    // Reads a 4x4 block as RGBA, repeating the last row/column for blocks past the image edge
+    Block FetchBlock(const unsigned char* pixels, int width, int height, int channels, int blockX, int blockY)
+    {
+        Block block;
+        for (int y = 0; y < 4; ++y) {
+            int sy = std::min(blockY * 4 + y, height - 1);
+            for (int x = 0; x < 4; ++x) {
+                int sx = std::min(blockX * 4 + x, width - 1);
+                const unsigned char* source = pixels + (static_cast<size_t>(sy) * width + sx) * channels;
+                uint8_t* texel = block.texels[y * 4 + x];
+                texel[0] = source[0];
+                texel[1] = source[1];
+                texel[2] = source[2];
+                texel[3] = channels == 4 ? source[3] : 255;
+            }
+        }
+        return block;
+    }
+
+    uint16_t To565(const glm::vec3& color)
+    {
+        int r = std::clamp(static_cast<int>(std::lround(color.r * 31.0f / 255.0f)), 0, 31);
+        int g = std::clamp(static_cast<int>(std::lround(color.g * 63.0f / 255.0f)), 0, 63);
+        int b = std::clamp(static_cast<int>(std::lround(color.b * 31.0f / 255.0f)), 0, 31);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    glm::ivec3 From565(uint16_t color)
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+        return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    // Palette of a color block; `opaqueOnly` forces the 4-color interpretation used inside BC3
+    void ColorPalette(uint16_t c0, uint16_t c1, bool opaqueOnly, glm::ivec4 palette[4])
+    {
+        glm::ivec3 a = From565(c0);
+        glm::ivec3 b = From565(c1);
+        palette[0] = glm::ivec4(a, 255);
+        palette[1] = glm::ivec4(b, 255);
+        if (c0 > c1 || opaqueOnly) {
+            palette[2] = glm::ivec4((2 * a + b) / 3, 255);
+            palette[3] = glm::ivec4((a + 2 * b) / 3, 255);
+        }
+        else {
+            palette[2] = glm::ivec4((a + b) / 2, 255);
+            palette[3] = glm::ivec4(0, 0, 0, 0);
+        }
+    }
+
+    int ColorDistance(const uint8_t* texel, const glm::ivec4& color)
+    {
+        int dr = texel[0] - color.r;
+        int dg = texel[1] - color.g;
+        int db = texel[2] - color.b;
+        return dr * dr + dg * dg + db * db;
+    }
+
+    // Picks the closest palette entry per texel; returns the packed indices and the squared error
+    uint32_t ColorIndices(const Block& block, uint16_t c0, uint16_t c1, int& error)
+    {
+        glm::ivec4 palette[4];
+        ColorPalette(c0, c1, true, palette);
+
+        uint32_t indices = 0;
+        error = 0;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int bestDistance = ColorDistance(block.texels[i], palette[0]);
+            for (int p = 1; p < 4; ++p) {
+                int distance = ColorDistance(block.texels[i], palette[p]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+            error += bestDistance;
+        }
+        return indices;
+    }
+
+    // Least-squares endpoints for fixed indices (weights of c0 per index: 1, 0, 2/3, 1/3)
+    bool RefineEndpoints(const Block& block, uint32_t indices, glm::vec3& e0, glm::vec3& e1)
+    {
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        glm::vec3 ax(0.0f), bx(0.0f);
+        for (int i = 0; i < 16; ++i) {
+            float a = weights[(indices >> (i * 2)) & 3];
+            float b = 1.0f - a;
+            glm::vec3 x(block.texels[i][0], block.texels[i][1], block.texels[i][2]);
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            ax += a * x;
+            bx += b * x;
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) {
+            return false;
+        }
+        e0 = (ax * bb - bx * ab) / determinant;
+        e1 = (bx * aa - ax * ab) / determinant;
+        return true;
+    }
+
+    void EncodeColorBlock(const Block& block, unsigned char* out)
+    {
+        glm::vec3 mean(0.0f);
+        glm::vec3 minColor(255.0f);
+        glm::vec3 maxColor(0.0f);
+        for (int i = 0; i < 16; ++i) {
+            glm::vec3 color(block.texels[i][0], block.texels[i][1], block.texels[i][2]);
+            mean += color;
+            minColor = glm::min(minColor, color);
+            maxColor = glm::max(maxColor, color);
+        }
+        mean /= 16.0f;
+
+        // Principal axis of the colors by power iteration on their covariance
+        glm::mat3 covariance(0.0f);
+        for (int i = 0; i < 16; ++i) {
+            glm::vec3 d = glm::vec3(block.texels[i][0], block.texels[i][1], block.texels[i][2]) - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+        glm::vec3 axis = maxColor - minColor;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            glm::vec3 next = covariance * axis;
+            float length = glm::length(next);
+            if (length < 1e-6f) {
+                break;
+            }
+            axis = next / length;
+        }
+
+        glm::vec3 e0 = maxColor;
+        glm::vec3 e1 = minColor;
+        float axisLength = glm::length(axis);
+        if (axisLength > 1e-6f) {
+            axis /= axisLength;
+            float lowest = 1e9f;
+            float highest = -1e9f;
+            for (int i = 0; i < 16; ++i) {
+                float t = glm::dot(glm::vec3(block.texels[i][0], block.texels[i][1], block.texels[i][2]) - mean, axis);
+                lowest = std::min(lowest, t);
+                highest = std::max(highest, t);
+            }
+            // Inset the endpoints slightly; the extremes are usually outliers of the fit
+            float inset = (highest - lowest) / 16.0f;
+            e0 = mean + axis * (highest - inset);
+            e1 = mean + axis * (lowest + inset);
+        }
+
+        uint16_t c0 = To565(e0);
+        uint16_t c1 = To565(e1);
+        int error;
+        uint32_t indices = ColorIndices(block, c0, c1, error);
+
+        glm::vec3 refined0, refined1;
+        if (error > 0 && RefineEndpoints(block, indices, refined0, refined1)) {
+            uint16_t r0 = To565(refined0);
+            uint16_t r1 = To565(refined1);
+            int refinedError;
+            uint32_t refinedIndices = ColorIndices(block, r0, r1, refinedError);
+            if (refinedError < error) {
+                c0 = r0;
+                c1 = r1;
+                indices = refinedIndices;
+            }
+        }
+
+        // c0 > c1 selects the 4-color mode; swapping the endpoints swaps indices 0<->1 and 2<->3
+        if (c0 < c1) {
+            std::swap(c0, c1);
+            indices ^= 0x55555555u;
+        }
+        else if (c0 == c1) {
+            indices = 0;
+        }
+
+        memcpy(out, &c0, 2);
+        memcpy(out + 2, &c1, 2);
+        memcpy(out + 4, &indices, 4);
+    }
+
+    void AlphaPalette(uint8_t a0, uint8_t a1, int palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1) {
+            for (int i = 1; i < 7; ++i) {
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+            }
+        }
+        else {
+            for (int i = 1; i < 5; ++i) {
+                palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // BC4 block for one channel of the texels
+    void EncodeChannelBlock(const Block& block, int channel, unsigned char* out)
+    {
+        uint8_t lowest = 255;
+        uint8_t highest = 0;
+        for (int i = 0; i < 16; ++i) {
+            lowest = std::min(lowest, block.texels[i][channel]);
+            highest = std::max(highest, block.texels[i][channel]);
+        }
+
+        // 8-value mode (a0 > a1); a flat block needs no indices at all
+        uint8_t a0 = highest;
+        uint8_t a1 = lowest;
+        int palette[8];
+        AlphaPalette(a0, a1, palette);
+
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            for (int i = 0; i < 16; ++i) {
+                int value = block.texels[i][channel];
+                int best = 0;
+                for (int p = 1; p < 8; ++p) {
+                    if (std::abs(palette[p] - value) < std::abs(palette[best] - value)) {
+                        best = p;
+                    }
+                }
+                indices |= static_cast<uint64_t>(best) << (i * 3);
+            }
+        }
+
+        out[0] = a0;
+        out[1] = a1;
+        for (int i = 0; i < 6; ++i) {
+            out[2 + i] = static_cast<unsigned char>(indices >> (i * 8));
+        }
+    }
+
+    void DecodeColorBlock(const unsigned char* in, bool opaqueOnly, uint8_t texels[16][4])
+    {
+        uint16_t c0, c1;
+        uint32_t indices;
+        memcpy(&c0, in, 2);
+        memcpy(&c1, in + 2, 2);
+        memcpy(&indices, in + 4, 4);
+
+        glm::ivec4 palette[4];
+        ColorPalette(c0, c1, opaqueOnly, palette);
+        for (int i = 0; i < 16; ++i) {
+            const glm::ivec4& color = palette[(indices >> (i * 2)) & 3];
+            texels[i][0] = static_cast<uint8_t>(color.r);
+            texels[i][1] = static_cast<uint8_t>(color.g);
+            texels[i][2] = static_cast<uint8_t>(color.b);
+            texels[i][3] = static_cast<uint8_t>(color.a);
+        }
+    }
+
+    void DecodeChannelBlock(const unsigned char* in, int channel, uint8_t texels[16][4])
+    {
+        int palette[8];
+        AlphaPalette(in[0], in[1], palette);
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i) {
+            indices |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+        }
+        for (int i = 0; i < 16; ++i) {
+            texels[i][channel] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+        }
+    }
+
+}
+
+size_t BlockCompression::BlockBytes(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t BlockCompression::CompressedSize(BlockFormat format, int width, int height)
+{
+    size_t blocksX = (std::max(width, 1) + 3) / 4;
+    size_t blocksY = (std::max(height, 1) + 3) / 4;
+    return blocksX * blocksY * BlockBytes(format);
+}
+
+uint32_t BlockCompression::GlInternalFormat(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    default: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+}
+
+bool BlockCompression::FromGlInternalFormat(uint32_t internalFormat, BlockFormat& format)
+{
+    switch (internalFormat) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: format = BlockFormat::BC1; return true;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: format = BlockFormat::BC3; return true;
+    case GL_COMPRESSED_RG_RGTC2: format = BlockFormat::BC5; return true;
+    default: return false;
+    }
+}
+
+std::vector<unsigned char> BlockCompression::Encode(BlockFormat format, const unsigned char* pixels, int width, int height, int channels)
+{
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t blockBytes = BlockBytes(format);
+    std::vector<unsigned char> blocks(CompressedSize(format, width, height));
+
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            Block block = FetchBlock(pixels, width, height, channels, bx, by);
+            unsigned char* out = blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+
+            switch (format) {
+            case BlockFormat::BC1:
+                EncodeColorBlock(block, out);
+                break;
+            case BlockFormat::BC3:
+                EncodeChannelBlock(block, 3, out);
+                EncodeColorBlock(block, out + 8);
+                break;
+            case BlockFormat::BC5:
+                EncodeChannelBlock(block, 0, out);
+                EncodeChannelBlock(block, 1, out + 8);
+                break;
+            }
+        }
+    }
+
+    return blocks;
+}
+
+std::vector<unsigned char> BlockCompression::Decode(BlockFormat format, const unsigned char* blocks, int width, int height)
+{
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t blockBytes = BlockBytes(format);
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const unsigned char* in = blocks + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+            uint8_t texels[16][4];
+
+            switch (format) {
+            case BlockFormat::BC1:
+                DecodeColorBlock(in, false, texels);
+                break;
+            case BlockFormat::BC3:
+                DecodeColorBlock(in + 8, true, texels);
+                DecodeChannelBlock(in, 3, texels);
+                break;
+            case BlockFormat::BC5:
+                for (int i = 0; i < 16; ++i) {
+                    texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+                DecodeChannelBlock(in, 0, texels);
+                DecodeChannelBlock(in + 8, 1, texels);
+                break;
+            }
+
+            for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+                for (int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+                    memcpy(&pixels[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], texels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+
+    return pixels;
+}
+
+BlockCompressionError BlockCompression::MeasureError(BlockFormat format, const unsigned char* pixels, int channels, const unsigned char* decoded, int width, int height)
+{
+    BlockCompressionError error;
+    double sums[4] = {};
+    size_t count = static_cast<size_t>(width) * height;
+
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            int source = c < channels ? pixels[i * channels + c] : 255;
+            double difference = source - decoded[i * 4 + c];
+            sums[c] += difference * difference;
+        }
+    }
+
+    int first = 0;
+    int last = format == BlockFormat::BC5 ? 2 : (format == BlockFormat::BC3 ? 4 : 3);
+    double total = 0.0;
+    for (int c = 0; c < 4; ++c) {
+        error.rmse[c] = count ? std::sqrt(sums[c] / count) : 0.0;
+        if (c >= first && c < last) {
+            total += sums[c];
+        }
+    }
+
+    double meanSquared = count ? total / (count * (last - first)) : 0.0;
+    error.rmseColor = std::sqrt(meanSquared);
+    error.psnr = meanSquared > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquared) : 99.0;
+    return error;
+}
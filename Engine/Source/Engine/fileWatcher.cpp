@@ -0,0 +1,187 @@
+#include "fileWatcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // Changes seen but not yet quiet for FileWatcher::SETTLE_TIME, by path
+    void PushSettled(std::unordered_map<std::string, Clock::time_point>& pending, MpscQueue<FileChange>& changes, Clock::time_point now)
+    {
+        for (auto it = pending.begin(); it != pending.end(); ) {
+            if (now - it->second >= FileWatcher::SETTLE_TIME) {
+                changes.Push({ it->first, it->second });
+                it = pending.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+}
+
+FileWatcher::FileWatcher(const std::vector<std::string>& directories)
+    : m_directories(directories)
+{
+    for (std::string& directory : m_directories) {
+        while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\')) {
+            directory.pop_back();
+        }
+    }
+
+    m_usesInotify = OpenInotify();
+    if (m_usesInotify) {
+        m_thread = std::thread(&FileWatcher::RunInotify, this);
+    }
+    else {
+        m_thread = std::thread(&FileWatcher::RunPolling, this);
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    m_stopping = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+#ifdef __linux__
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
+#endif
+}
+
+std::vector<FileChange> FileWatcher::PollChanges()
+{
+    std::vector<FileChange> changes;
+    while (std::optional<FileChange> change = m_changes.Pop()) {
+        auto same = std::find_if(changes.begin(), changes.end(), [&](const FileChange& c) { return c.path == change->path; });
+        if (same == changes.end()) {
+            changes.push_back(std::move(*change));
+        }
+    }
+    return changes;
+}
+
+#ifdef __linux__
+
+bool FileWatcher::OpenInotify()
+{
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0) {
+        return false;
+    }
+
+    // Close-after-write catches in-place saves, moved-to catches tools that write a temporary and rename it
+    for (const std::string& directory : m_directories) {
+        int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch < 0) {
+            std::cerr << "Cannot watch '" << directory << "' with inotify, polling instead" << std::endl;
+            close(m_inotify);
+            m_inotify = -1;
+            return false;
+        }
+        m_directoryByWatch[watch] = directory;
+    }
+    return true;
+}
+
+void FileWatcher::RunInotify()
+{
+    std::unordered_map<std::string, Clock::time_point> pending;
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd descriptor = { m_inotify, POLLIN, 0 };
+
+    while (!m_stopping) {
+        // Short timeouts so settled changes go out promptly and the destructor is not kept waiting
+        int timeout = pending.empty() ? 100 : 10;
+        if (poll(&descriptor, 1, timeout) > 0) {
+            ssize_t length;
+            while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+                Clock::time_point now = Clock::now();
+                for (char* cursor = buffer; cursor < buffer + length; ) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+                    auto directory = m_directoryByWatch.find(event->wd);
+                    if (event->len > 0 && !(event->mask & IN_ISDIR) && directory != m_directoryByWatch.end()) {
+                        pending[directory->second + "/" + event->name] = now;
+                    }
+                    cursor += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+
+        PushSettled(pending, m_changes, Clock::now());
+    }
+}
+
+#else
+
+bool FileWatcher::OpenInotify()
+{
+    return false;
+}
+
+void FileWatcher::RunInotify()
+{
+}
+
+#endif
+
+void FileWatcher::RunPolling()
+{
+    struct FileState {
+        uintmax_t size = 0;
+        std::filesystem::file_time_type modifiedTime;
+    };
+
+    auto scan = [this]() {
+        std::unordered_map<std::string, FileState> states;
+        for (const std::string& directory : m_directories) {
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+                std::error_code entryError;
+                if (!entry.is_regular_file(entryError)) {
+                    continue;
+                }
+                FileState& state = states[directory + "/" + entry.path().filename().string()];
+                state.size = entry.file_size(entryError);
+                state.modifiedTime = entry.last_write_time(entryError);
+            }
+        }
+        return states;
+    };
+
+    std::unordered_map<std::string, FileState> known = scan();
+    std::unordered_map<std::string, Clock::time_point> pending;
+    Clock::time_point nextScan = Clock::now() + POLL_INTERVAL;
+
+    while (!m_stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(pending.empty() ? 50 : 10));
+
+        Clock::time_point now = Clock::now();
+        if (now >= nextScan) {
+            std::unordered_map<std::string, FileState> current = scan();
+            for (const auto& [path, state] : current) {
+                auto previous = known.find(path);
+                if (previous == known.end() || previous->second.size != state.size || previous->second.modifiedTime != state.modifiedTime) {
+                    pending[path] = now;
+                }
+            }
+            known = std::move(current);
+            nextScan = now + POLL_INTERVAL;
+        }
+
+        PushSettled(pending, m_changes, now);
+    }
+}
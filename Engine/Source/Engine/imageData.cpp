@@ -0,0 +1,45 @@
+#include "imageData.h"
+
+#include <limits>
+#include <stb_image.h>
+
+#include "vfs.h"
+
+ImageData ImageData::Load(const std::string& filePath)
+{
+    ImageData image;
+
+    VfsFile file(filePath);
+    if (!file.IsOpen() || file.Size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return image;
+    }
+
+    unsigned char* data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.Data()), static_cast<int>(file.Size()),
+        &image.width, &image.height, &image.channels, 0);
+    if (!data) {
+        return image;
+    }
+
+    size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    if (image.channels >= 3) {
+        image.pixels.assign(data, data + pixelCount * image.channels);
+    }
+    else {
+        // Expand grey / grey+alpha so every image uploads as RGB or RGBA
+        int channels = image.channels == 1 ? 3 : 4;
+        image.pixels.resize(pixelCount * channels);
+        for (size_t i = 0; i < pixelCount; ++i) {
+            const unsigned char* source = data + i * image.channels;
+            unsigned char* target = image.pixels.data() + i * channels;
+            target[0] = target[1] = target[2] = source[0];
+            if (channels == 4) {
+                target[3] = source[1];
+            }
+        }
+        image.channels = channels;
+    }
+
+    stbi_image_free(data);
+
+    return image;
+}
@@ -0,0 +1,222 @@
+#include "ktxFile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+
+#include "blockCompression.h"
+
+namespace {
+
+    constexpr unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr uint32_t ENDIANNESS = 0x04030201;
+    constexpr char SOURCE_KEY[] = "GMEngine.source";
+    // Larger than any GL implementation's texture limit; keeps the level size math far from overflowing
+    constexpr uint32_t MAX_DIMENSION = 1 << 16;
+
+    uint32_t PadTo4(uint32_t value)
+    {
+        return (value + 3) & ~3u;
+    }
+
+    uint32_t BaseFormatFor(uint32_t glInternalFormat, uint32_t glFormat)
+    {
+        switch (glInternalFormat) {
+        case GL_COMPRESSED_RG_RGTC2: return GL_RG;
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return GL_RGB;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return GL_RGBA;
+        default: return glFormat;
+        }
+    }
+
+    // Bytes per pixel of the uncompressed layouts TextureCache uploads, 0 for any other
+    size_t PixelBytes(uint32_t glFormat, uint32_t glType)
+    {
+        if (glType != GL_UNSIGNED_BYTE) {
+            return 0;
+        }
+        switch (glFormat) {
+        case GL_RED: return 1;
+        case GL_RG: return 2;
+        case GL_RGB: return 3;
+        case GL_RGBA: return 4;
+        default: return 0;
+        }
+    }
+
+    // Smallest imageSize a level may declare without GL reading past it; 0 when the format is unknown
+    // and TextureCache will refuse the file anyway
+    size_t LevelBytes(const KtxHeader& header, int width, int height)
+    {
+        if (header.glType != 0) {
+            return PixelBytes(header.glFormat, header.glType) * width * height;
+        }
+        BlockFormat format;
+        if (!BlockCompression::FromGlInternalFormat(header.glInternalFormat, format)) {
+            return 0;
+        }
+        return BlockCompression::CompressedSize(format, width, height);
+    }
+
+}
+
+KtxHeader KtxFile::MakeHeader(uint32_t glInternalFormat, uint32_t glFormat, uint32_t glType, int width, int height)
+{
+    KtxHeader header = {};
+    memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+    header.endianness = ENDIANNESS;
+    header.glType = glType;
+    header.glTypeSize = 1;
+    header.glFormat = glFormat;
+    header.glInternalFormat = glInternalFormat;
+    header.glBaseInternalFormat = BaseFormatFor(glInternalFormat, glFormat);
+    header.pixelWidth = static_cast<uint32_t>(width);
+    header.pixelHeight = static_cast<uint32_t>(height);
+    header.numberOfFaces = 1;
+    return header;
+}
+
+bool KtxFile::Write(const std::string& path, const KtxHeader& header, const std::vector<KtxLevel>& levels, const SourceStamp& source)
+{
+    // One key/value pair: the NUL-terminated key followed by the raw source stamp
+    uint32_t keyAndValueBytes = static_cast<uint32_t>(sizeof(SOURCE_KEY) + sizeof(SourceStamp));
+    KtxHeader fileHeader = header;
+    fileHeader.numberOfMipmapLevels = static_cast<uint32_t>(levels.size());
+    fileHeader.bytesOfKeyValueData = sizeof(uint32_t) + PadTo4(keyAndValueBytes);
+
+    static const char zeros[4] = {};
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(reinterpret_cast<const char*>(&keyAndValueBytes), sizeof(keyAndValueBytes));
+        file.write(SOURCE_KEY, sizeof(SOURCE_KEY));
+        file.write(reinterpret_cast<const char*>(&source), sizeof(source));
+        file.write(zeros, PadTo4(keyAndValueBytes) - keyAndValueBytes);
+
+        for (const KtxLevel& level : levels) {
+            uint32_t imageSize = static_cast<uint32_t>(level.size);
+            file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+            file.write(reinterpret_cast<const char*>(level.data), static_cast<std::streamsize>(level.size));
+            file.write(zeros, PadTo4(imageSize) - imageSize);
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
+
+bool KtxFile::Open(const std::string& path)
+{
+    m_header = nullptr;
+    m_levels.clear();
+    m_hasSource = false;
+    m_path = path;
+
+    if (!m_file.Open(path) || m_file.Size() < sizeof(KtxHeader)) {
+        return false;
+    }
+
+    const KtxHeader* header = reinterpret_cast<const KtxHeader*>(m_file.Data());
+    if (memcmp(header->identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header->endianness != ENDIANNESS
+        || header->pixelDepth > 1 || header->numberOfArrayElements != 0 || header->numberOfFaces != 1
+        || header->pixelWidth == 0 || header->pixelHeight == 0 || header->pixelWidth > MAX_DIMENSION || header->pixelHeight > MAX_DIMENSION) {
+        return false;
+    }
+    if (header->glType != 0 && PixelBytes(header->glFormat, header->glType) == 0) {
+        return false;
+    }
+
+    const unsigned char* cursor = reinterpret_cast<const unsigned char*>(m_file.Data()) + sizeof(KtxHeader);
+    const unsigned char* end = reinterpret_cast<const unsigned char*>(m_file.End());
+    if (header->bytesOfKeyValueData > static_cast<size_t>(end - cursor)) {
+        return false;
+    }
+
+    // Only our own key is interpreted; anything else is skipped
+    const unsigned char* keyValueEnd = cursor + header->bytesOfKeyValueData;
+    while (keyValueEnd - cursor >= 4) {
+        uint32_t keyAndValueBytes;
+        memcpy(&keyAndValueBytes, cursor, sizeof(keyAndValueBytes));
+        cursor += sizeof(keyAndValueBytes);
+        if (keyAndValueBytes > static_cast<size_t>(keyValueEnd - cursor)) {
+            return false;
+        }
+        if (keyAndValueBytes == sizeof(SOURCE_KEY) + sizeof(SourceStamp) && memcmp(cursor, SOURCE_KEY, sizeof(SOURCE_KEY)) == 0) {
+            memcpy(&m_source, cursor + sizeof(SOURCE_KEY), sizeof(SourceStamp));
+            m_sourceOffset = static_cast<uint64_t>(cursor + sizeof(SOURCE_KEY) - reinterpret_cast<const unsigned char*>(m_file.Data()));
+            m_hasSource = true;
+        }
+        cursor += PadTo4(keyAndValueBytes);
+    }
+    cursor = keyValueEnd;
+
+    uint32_t levelCount = std::max(header->numberOfMipmapLevels, 1u);
+    if (levelCount > static_cast<uint32_t>(std::bit_width(std::max(header->pixelWidth, header->pixelHeight)))) {
+        return false;
+    }
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        if (end - cursor < 4) {
+            return false;
+        }
+        uint32_t imageSize;
+        memcpy(&imageSize, cursor, sizeof(imageSize));
+        cursor += sizeof(imageSize);
+        if (imageSize > static_cast<size_t>(end - cursor)) {
+            return false;
+        }
+
+        KtxLevel level;
+        level.data = cursor;
+        level.size = imageSize;
+        level.width = std::max(1, static_cast<int>(header->pixelWidth >> i));
+        level.height = std::max(1, static_cast<int>(header->pixelHeight >> i));
+        // A truncated level would have GL read past the mapping
+        if (imageSize < LevelBytes(*header, level.width, level.height)) {
+            return false;
+        }
+        m_levels.push_back(level);
+        cursor += std::min<size_t>(PadTo4(imageSize), end - cursor);
+    }
+
+    m_header = header;
+    return true;
+}
+
+bool KtxFile::IsFreshFor(const std::string& sourcePath)
+{
+    if (!m_header || !m_hasSource) {
+        return false;
+    }
+
+    int64_t bakedTime = m_source.modifiedTime;
+    if (!SourceStamp::Matches(sourcePath, m_source)) {
+        return false;
+    }
+    if (m_source.modifiedTime != bakedTime && !m_file.IsArchived()) {
+        SourceStamp::StoreModifiedTime(m_path, m_sourceOffset + offsetof(SourceStamp, modifiedTime), m_source.modifiedTime);
+    }
+    return true;
+}
+
+size_t KtxFile::DataBytes() const
+{
+    size_t bytes = 0;
+    for (const KtxLevel& level : m_levels) {
+        bytes += level.size;
+    }
+    return bytes;
+}
@@ -0,0 +1,195 @@
+#include "lz4Block.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    constexpr size_t MIN_MATCH = 4;
+    // The last match must start at least 12 bytes before the end and the last 5 bytes are literals
+    constexpr size_t MATCH_FIND_LIMIT = 12;
+    constexpr size_t LAST_LITERALS = 5;
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr int HASH_BITS = 12;
+
+    uint32_t Read32(const char* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t HashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Writes the 255-run extension of a length whose 4-bit field saturated
+    bool WriteLength(size_t length, char*& out, const char* end)
+    {
+        for (; length >= 255; length -= 255) {
+            if (out >= end) {
+                return false;
+            }
+            *out++ = static_cast<char>(255);
+        }
+        if (out >= end) {
+            return false;
+        }
+        *out++ = static_cast<char>(length);
+        return true;
+    }
+
+    bool WriteSequence(const char* literals, size_t literalLength, size_t offset, size_t matchLength, char*& out, const char* end)
+    {
+        if (out >= end) {
+            return false;
+        }
+        char* token = out++;
+        size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+        *token = static_cast<char>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+        if (literalLength >= 15 && !WriteLength(literalLength - 15, out, end)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - out) < literalLength) {
+            return false;
+        }
+        memcpy(out, literals, literalLength);
+        out += literalLength;
+
+        // The final sequence is literals only
+        if (matchLength == 0) {
+            return true;
+        }
+
+        if (end - out < 2) {
+            return false;
+        }
+        *out++ = static_cast<char>(offset & 0xFF);
+        *out++ = static_cast<char>(offset >> 8);
+        return matchCode < 15 || WriteLength(matchCode - 15, out, end);
+    }
+
+    bool ReadLength(size_t& length, const unsigned char*& in, const unsigned char* end)
+    {
+        unsigned char byte;
+        do {
+            if (in >= end) {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+}
+
+size_t Lz4::CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t Lz4::Compress(const char* source, size_t size, char* target, size_t capacity)
+{
+    char* out = target;
+    const char* end = target + capacity;
+    size_t anchor = 0;
+
+    if (size >= MATCH_FIND_LIMIT + 1) {
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+        size_t matchLimit = size - LAST_LITERALS;
+        size_t position = 0;
+
+        while (position < size - MATCH_FIND_LIMIT) {
+            uint32_t sequence = Read32(source + position);
+            uint32_t& slot = table[HashSequence(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(position);
+
+            if (candidate >= position || position - candidate > MAX_OFFSET || Read32(source + candidate) != sequence) {
+                // Skip faster through data that does not compress
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+
+            // Extend backwards over literals that also match, then forwards
+            while (position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1]) {
+                --position;
+                --candidate;
+            }
+            size_t length = MIN_MATCH;
+            while (position + length < matchLimit && source[candidate + length] == source[position + length]) {
+                ++length;
+            }
+
+            if (!WriteSequence(source + anchor, position - anchor, position - candidate, length, out, end)) {
+                return 0;
+            }
+            position += length;
+            anchor = position;
+        }
+    }
+
+    if (!WriteSequence(source + anchor, size - anchor, 0, 0, out, end)) {
+        return 0;
+    }
+    return static_cast<size_t>(out - target);
+}
+
+bool Lz4::Decompress(const char* source, size_t size, char* target, size_t originalSize)
+{
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(source);
+    const unsigned char* inEnd = in + size;
+    char* out = target;
+    char* outEnd = target + originalSize;
+
+    while (in < inEnd) {
+        unsigned char token = *in++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(literalLength, in, inEnd)) {
+            return false;
+        }
+        if (static_cast<size_t>(inEnd - in) < literalLength || static_cast<size_t>(outEnd - out) < literalLength) {
+            return false;
+        }
+        memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+
+        // The last sequence ends after its literals
+        if (in == inEnd) {
+            break;
+        }
+
+        if (inEnd - in < 2) {
+            return false;
+        }
+        size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > static_cast<size_t>(out - target)) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(matchLength, in, inEnd)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (static_cast<size_t>(outEnd - out) < matchLength) {
+            return false;
+        }
+
+        // Matches may overlap their own output (runs), so copy forwards byte by byte
+        const char* match = out - offset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            out[i] = match[i];
+        }
+        out += matchLength;
+    }
+
+    return out == outEnd;
+}
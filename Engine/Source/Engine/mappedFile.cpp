@@ -0,0 +1,158 @@
+#include "mappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filePath)
+{
+    Open(filePath);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_isOpen = std::exchange(other.m_isOpen, false);
+#ifdef _WIN32
+        m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+        m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_fileHandle = file;
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_isOpen = true;
+
+    // Empty files cannot be mapped, but they are still valid (empty) views
+    if (m_size == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        Close();
+        return false;
+    }
+    m_mappingHandle = mapping;
+
+    m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle) {
+        CloseHandle(m_fileHandle);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    m_size = static_cast<size_t>(info.st_size);
+    m_isOpen = true;
+
+    // Empty files cannot be mapped, but they are still valid (empty) views
+    if (m_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        m_size = 0;
+        m_isOpen = false;
+        return false;
+    }
+
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+#endif
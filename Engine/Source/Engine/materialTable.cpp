@@ -0,0 +1,77 @@
+#include "materialTable.h"
+
+#include "textureCache.h"
+
+MaterialTable& MaterialTable::Shared()
+{
+    static MaterialTable table;
+    return table;
+}
+
+MaterialId MaterialTable::Intern(const std::string& library, const std::string& name, const Material& material)
+{
+    std::string key = library + "|" + name;
+
+    MaterialId id;
+    auto existing = m_idsByKey.find(key);
+    if (existing != m_idsByKey.end()) {
+        id = existing->second;
+        m_refCounts[id]++;
+        ReleaseTexture(id);
+    }
+    else if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+        m_refCounts[id] = 1;
+        m_keys[id] = key;
+        m_idsByKey[key] = id;
+    }
+    else {
+        id = static_cast<MaterialId>(m_refCounts.size());
+        m_ambient.emplace_back();
+        m_diffuse.emplace_back();
+        m_specular.emplace_back();
+        m_shininess.emplace_back();
+        m_textures.emplace_back();
+        m_layers.emplace_back();
+        m_refCounts.push_back(1);
+        m_keys.push_back(key);
+        m_idsByKey[key] = id;
+    }
+
+    m_ambient[id] = material.ambient;
+    m_diffuse[id] = material.diffuse;
+    m_specular[id] = material.specular;
+    m_shininess[id] = material.shininess;
+    m_textures[id] = material.textureID;
+    m_layers[id] = material.textureLayer;
+    return id;
+}
+
+void MaterialTable::Release(MaterialId id)
+{
+    if (!IsLive(id) || --m_refCounts[id] > 0) {
+        return;
+    }
+
+    ReleaseTexture(id);
+    m_textures[id] = 0;
+    m_layers[id] = -1;
+    m_idsByKey.erase(m_keys[id]);
+    m_keys[id].clear();
+    m_freeIds.push_back(id);
+}
+
+void MaterialTable::ReleaseTexture(MaterialId id)
+{
+    if (m_textures[id] == 0) {
+        return;
+    }
+
+    if (m_layers[id] >= 0) {
+        TextureCache::Shared().Release(TextureLayer{ m_textures[id], static_cast<uint32_t>(m_layers[id]) });
+    }
+    else {
+        TextureCache::Shared().Release(m_textures[id]);
+    }
+}
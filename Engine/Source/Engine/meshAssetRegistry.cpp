@@ -0,0 +1,238 @@
+#include "meshAssetRegistry.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+#include "engineLog.h"
+#include "threadPool.h"
+#include "materialTable.h"
+
+MeshAssetRegistry::MeshAssetRegistry()
+    : m_importedMeshes(std::make_shared<MpscQueue<PendingUpload>>())
+{
+}
+
+std::string MeshAssetRegistry::ResolvePath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(path, error);
+    if (error) {
+        resolved = std::filesystem::absolute(path).lexically_normal();
+    }
+    return resolved.generic_string();
+}
+
+std::string MeshAssetRegistry::MakeKey(const std::string& objFilePath, const std::string& mtlFilePath)
+{
+    return ResolvePath(objFilePath) + "|" + ResolvePath(mtlFilePath);
+}
+
+MeshHandle MeshAssetRegistry::AllocateSlot(const std::string& key)
+{
+    uint32_t index;
+    if (!m_freeSlots.empty()) {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else {
+        index = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+    }
+
+    Slot& slot = m_slots[index];
+    slot.asset = MeshAsset();
+    slot.asset.key = key;
+    slot.refCount = 1;
+
+    MeshHandle handle{ index, slot.generation };
+    m_handlesByKey[key] = handle;
+    return handle;
+}
+
+bool MeshAssetRegistry::IsLive(MeshHandle handle) const
+{
+    return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation && m_slots[handle.index].refCount > 0;
+}
+
+MeshHandle MeshAssetRegistry::Acquire(const std::string& objFilePath, const std::string& mtlFilePath, bool async)
+{
+    std::string key = MakeKey(objFilePath, mtlFilePath);
+
+    auto existing = m_handlesByKey.find(key);
+    if (existing != m_handlesByKey.end()) {
+        m_slots[existing->second.index].refCount++;
+        return existing->second;
+    }
+
+    MeshHandle handle = AllocateSlot(key);
+    m_slots[handle.index].objFilePath = objFilePath;
+    m_slots[handle.index].mtlFilePath = mtlFilePath;
+
+    if (async) {
+        ImportAsync(handle, false, std::chrono::steady_clock::now());
+    }
+    else {
+        ObjLoader loader(objFilePath, mtlFilePath, ImportOptions);
+        AttachModel(m_slots[handle.index].asset, loader);
+    }
+
+    return handle;
+}
+
+void MeshAssetRegistry::ImportAsync(MeshHandle handle, bool isReload, std::chrono::steady_clock::time_point changed)
+{
+    auto queue = m_importedMeshes;
+    MeshImportOptions options = ImportOptions;
+    Slot& slot = m_slots[handle.index];
+    uint32_t revision = ++slot.revision;
+    std::string objFilePath = slot.objFilePath;
+    std::string mtlFilePath = slot.mtlFilePath;
+    ThreadPool::Shared().Submit([handle, revision, queue, objFilePath, mtlFilePath, options, isReload, changed]() {
+        auto loader = std::make_unique<ObjLoader>(objFilePath, mtlFilePath, options, false);
+        queue->Push({ handle, revision, std::move(loader), isReload, changed });
+    });
+}
+
+size_t MeshAssetRegistry::Reload(const std::string& changedPath, std::chrono::steady_clock::time_point changed)
+{
+    std::string path = ResolvePath(changedPath);
+    size_t count = 0;
+    for (uint32_t i = 0; i < m_slots.size(); ++i) {
+        // Keys are "<resolved obj>|<resolved mtl>"
+        const Slot& slot = m_slots[i];
+        std::string_view key = slot.asset.key;
+        size_t separator = key.find('|');
+        if (slot.refCount > 0 && separator != std::string_view::npos && (key.substr(0, separator) == path || key.substr(separator + 1) == path)) {
+            ImportAsync({ i, slot.generation }, true, changed);
+            count++;
+        }
+    }
+    return count;
+}
+
+void MeshAssetRegistry::Release(MeshHandle handle)
+{
+    if (!IsLive(handle)) {
+        return;
+    }
+
+    Slot& slot = m_slots[handle.index];
+    if (--slot.refCount > 0) {
+        return;
+    }
+
+    // An import still in flight is freed by ProcessUploads once it sees the stale generation
+    DeleteGpuObjects(slot.asset.VAOS, slot.asset.VBOS, slot.asset.EBOS, slot.asset.Materials);
+    m_handlesByKey.erase(slot.asset.key);
+    slot.asset = MeshAsset();
+    slot.generation++;
+    m_freeSlots.push_back(handle.index);
+}
+
+const MeshAsset* MeshAssetRegistry::Get(MeshHandle handle) const
+{
+    return IsLive(handle) ? &m_slots[handle.index].asset : nullptr;
+}
+
+uint32_t MeshAssetRegistry::RefCount(MeshHandle handle) const
+{
+    return IsLive(handle) ? m_slots[handle.index].refCount : 0;
+}
+
+void MeshAssetRegistry::ProcessUploads(double budgetMilliseconds)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(budgetMilliseconds));
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!m_uploadingMesh) {
+            std::optional<PendingUpload> next = m_importedMeshes->Pop();
+            if (!next) {
+                return;
+            }
+            m_uploadingMesh = std::make_unique<PendingUpload>(std::move(*next));
+        }
+
+        if (!m_uploadingMesh->loader->Upload(deadline)) {
+            return;
+        }
+
+        // Every user may have released the mesh while it was loading, or a newer import may have been started.
+        // Only the import that wins touches the shared material rows.
+        ObjLoader& loader = *m_uploadingMesh->loader;
+        const MeshHandle& handle = m_uploadingMesh->handle;
+        bool isCurrent = IsLive(handle) && m_slots[handle.index].revision == m_uploadingMesh->revision;
+        bool failed = !loader.Error().empty() || loader.ModelParts.empty();
+        if (isCurrent && m_uploadingMesh->isReload && failed) {
+            // A broken save keeps the previous version on screen until the next good one
+            std::cerr << "Failed to reload '" << m_slots[handle.index].objFilePath << "', keeping the previous version: "
+                << (loader.Error().empty() ? "no geometry" : loader.Error()) << std::endl;
+            isCurrent = false;
+        }
+
+        if (isCurrent) {
+            // A reload replaces the buffers between frames; renderers only hold the handle
+            MeshAsset& asset = m_slots[handle.index].asset;
+            DeleteGpuObjects(asset.VAOS, asset.VBOS, asset.EBOS, asset.Materials);
+            AttachModel(asset, loader);
+
+            if (m_uploadingMesh->isReload && EngineLog::Verbose) {
+                std::chrono::duration<double, std::milli> milliseconds = std::chrono::steady_clock::now() - m_uploadingMesh->changed;
+                std::cout << "Reloaded '" << m_slots[handle.index].objFilePath << "' " << milliseconds.count() << " ms after it changed\n";
+            }
+        }
+        else {
+            loader.DiscardMaterials();
+            DeleteGpuObjects(loader.VAOS, loader.VBOS, loader.EBOS, loader.MaterialIds);
+        }
+
+        m_uploadingMesh.reset();
+    }
+}
+
+void MeshAssetRegistry::AttachModel(MeshAsset& asset, ObjLoader& loader)
+{
+    loader.InternMaterials();
+    asset.VAOS = std::move(loader.VAOS);
+    asset.VBOS = std::move(loader.VBOS);
+    asset.EBOS = std::move(loader.EBOS);
+    asset.ModelParts = std::move(loader.ModelParts);
+    asset.Materials = std::move(loader.MaterialIds);
+
+    asset.BoundsMin = glm::vec3(std::numeric_limits<float>::max());
+    asset.BoundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (const ModelPart& part : asset.ModelParts) {
+        asset.BoundsMin = glm::min(asset.BoundsMin, part.boundsMin);
+        asset.BoundsMax = glm::max(asset.BoundsMax, part.boundsMax);
+    }
+    if (asset.ModelParts.empty()) {
+        asset.BoundsMin = asset.BoundsMax = glm::vec3(0.0f);
+    }
+    asset.IsLoaded = true;
+}
+
+void MeshAssetRegistry::DeleteGpuObjects(std::vector<GLuint>& VAOS, std::vector<GLuint>& VBOS, std::vector<GLuint>& EBOS, std::vector<MaterialId>& materials)
+{
+    for (auto vao : VAOS) {
+        glDeleteVertexArrays(1, &vao);
+    }
+
+    for (auto vbo : VBOS) {
+        glDeleteBuffers(1, &vbo);
+    }
+
+    for (auto ebo : EBOS) {
+        glDeleteBuffers(1, &ebo);
+    }
+
+    for (MaterialId material : materials) {
+        MaterialTable::Shared().Release(material);
+    }
+
+    VAOS.clear();
+    VBOS.clear();
+    EBOS.clear();
+    materials.clear();
+}
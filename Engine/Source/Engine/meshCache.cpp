@@ -0,0 +1,229 @@
+#include "meshCache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+
+#include "hash.h"
+
+namespace {
+
+    constexpr char MAGIC[4] = { 'G', 'M', 'S', 'H' };
+    constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    void WritePadding(std::ofstream& file, uint64_t& offset, uint64_t alignment)
+    {
+        static const char zeros[BLOB_ALIGNMENT] = {};
+        uint64_t aligned = AlignUp(offset, alignment);
+        file.write(zeros, static_cast<std::streamsize>(aligned - offset));
+        offset = aligned;
+    }
+
+}
+
+std::string MeshCache::CachePathFor(const std::string& sourcePath)
+{
+    return sourcePath + ".gmesh";
+}
+
+size_t MeshCache::IndexSize(uint32_t indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+bool MeshCache::Write(const std::string& sourcePath, const SourceStamp& source, const MeshImportOptions& options, const std::vector<ModelPart>& parts)
+{
+    GMeshHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceSize = source.size;
+    header.sourceModifiedTime = source.modifiedTime;
+    header.sourceHash = source.contentHash;
+    header.sourcePathHash = Hash::Fnv1a64(sourcePath);
+    header.partCount = static_cast<uint32_t>(parts.size());
+    for (const ModelPart& part : parts) {
+        header.lodCount += static_cast<uint32_t>(part.lods.size());
+    }
+    header.vertexFormat = static_cast<uint32_t>(parts.empty() ? VertexFormat::Float32 : parts[0].vertexFormat);
+    header.vertexStride = static_cast<uint32_t>(VertexFormats::Stride(static_cast<VertexFormat>(header.vertexFormat)));
+    header.optionsHash = options.CacheHash();
+
+    // Lay out the file: header, part table, LOD table, names, then the aligned blobs
+    std::vector<GMeshPart> table(parts.size());
+    std::vector<GMeshLod> lods;
+    lods.reserve(header.lodCount);
+    uint64_t namesOffset = sizeof(GMeshHeader) + sizeof(GMeshPart) * parts.size() + sizeof(GMeshLod) * header.lodCount;
+    uint64_t offset = namesOffset;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        table[i].lodFirst = static_cast<uint32_t>(lods.size());
+        table[i].lodCount = static_cast<uint32_t>(parts[i].lods.size());
+        for (const ModelLod& lod : parts[i].lods) {
+            lods.push_back({ lod.firstIndex, lod.indexCount, lod.error, 0 });
+        }
+
+        table[i].materialNameOffset = offset;
+        table[i].materialNameLength = static_cast<uint32_t>(parts[i].materialName.size());
+        offset += parts[i].materialName.size();
+    }
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const ModelPart& part = parts[i];
+        GMeshPart& entry = table[i];
+        entry.vertexCount = part.vertexCount;
+        entry.indexCount = part.indexCount;
+        entry.indexType = part.indexType;
+        memcpy(entry.boundsMin, &part.boundsMin[0], sizeof(entry.boundsMin));
+        memcpy(entry.boundsMax, &part.boundsMax[0], sizeof(entry.boundsMax));
+        entry.uvDensity = part.uvDensity;
+
+        offset = AlignUp(offset, BLOB_ALIGNMENT);
+        entry.vertexOffset = offset;
+        offset += part.VertexBytes();
+
+        offset = AlignUp(offset, BLOB_ALIGNMENT);
+        entry.indexOffset = offset;
+        offset += part.indices.size() * IndexSize(part.indexType);
+    }
+
+    // Write to a temporary file first so a reader never maps a half-written cache
+    std::string cachePath = CachePathFor(sourcePath);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(GMeshPart)));
+        file.write(reinterpret_cast<const char*>(lods.data()), static_cast<std::streamsize>(lods.size() * sizeof(GMeshLod)));
+        offset = namesOffset;
+        for (const ModelPart& part : parts) {
+            file.write(part.materialName.data(), static_cast<std::streamsize>(part.materialName.size()));
+            offset += part.materialName.size();
+        }
+
+        for (const ModelPart& part : parts) {
+            WritePadding(file, offset, BLOB_ALIGNMENT);
+            file.write(static_cast<const char*>(part.VertexData()), static_cast<std::streamsize>(part.VertexBytes()));
+            offset += part.VertexBytes();
+
+            WritePadding(file, offset, BLOB_ALIGNMENT);
+            if (part.indexType == GL_UNSIGNED_SHORT) {
+                std::vector<uint16_t> shortIndices(part.indices.begin(), part.indices.end());
+                file.write(reinterpret_cast<const char*>(shortIndices.data()), static_cast<std::streamsize>(shortIndices.size() * sizeof(uint16_t)));
+            }
+            else {
+                file.write(reinterpret_cast<const char*>(part.indices.data()), static_cast<std::streamsize>(part.indices.size() * sizeof(uint32_t)));
+            }
+            offset += part.indices.size() * IndexSize(part.indexType);
+        }
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    return !error;
+}
+
+bool MeshCache::Open(const std::string& sourcePath, const MeshImportOptions& options)
+{
+    m_header = nullptr;
+    m_parts = nullptr;
+    m_lods = nullptr;
+
+    if (!m_file.Open(CachePathFor(sourcePath))) {
+        return false;
+    }
+
+    if (m_file.Size() < sizeof(GMeshHeader)) {
+        return false;
+    }
+
+    const GMeshHeader* header = reinterpret_cast<const GMeshHeader*>(m_file.Data());
+    VertexFormat vertexFormat = options.vertexFormat;
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+        || header->vertexFormat != static_cast<uint32_t>(vertexFormat) || header->vertexStride != VertexFormats::Stride(vertexFormat)
+        || header->optionsHash != options.CacheHash() || header->sourcePathHash != Hash::Fnv1a64(sourcePath)) {
+        return false;
+    }
+
+    SourceStamp source;
+    source.size = header->sourceSize;
+    source.modifiedTime = header->sourceModifiedTime;
+    source.contentHash = header->sourceHash;
+    if (!SourceStamp::Matches(sourcePath, source)) {
+        return false;
+    }
+    if (source.modifiedTime != header->sourceModifiedTime && !m_file.IsArchived()) {
+        SourceStamp::StoreModifiedTime(CachePathFor(sourcePath), offsetof(GMeshHeader, sourceModifiedTime), source.modifiedTime);
+    }
+
+    uint64_t partsEnd = sizeof(GMeshHeader) + static_cast<uint64_t>(header->partCount) * sizeof(GMeshPart);
+    uint64_t tableEnd = partsEnd + static_cast<uint64_t>(header->lodCount) * sizeof(GMeshLod);
+    if (tableEnd > m_file.Size()) {
+        return false;
+    }
+
+    const GMeshPart* parts = reinterpret_cast<const GMeshPart*>(m_file.Data() + sizeof(GMeshHeader));
+    const GMeshLod* lods = reinterpret_cast<const GMeshLod*>(m_file.Data() + partsEnd);
+    for (uint32_t i = 0; i < header->partCount; ++i) {
+        const GMeshPart& part = parts[i];
+        if (static_cast<uint64_t>(part.lodFirst) + part.lodCount > header->lodCount) {
+            return false;
+        }
+        for (uint32_t l = 0; l < part.lodCount; ++l) {
+            const GMeshLod& lod = lods[part.lodFirst + l];
+            if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > part.indexCount) {
+                return false;
+            }
+        }
+        if (part.indexType != GL_UNSIGNED_SHORT && part.indexType != GL_UNSIGNED_INT) {
+            return false;
+        }
+        if (part.materialNameOffset + static_cast<uint64_t>(part.materialNameLength) > m_file.Size()
+            || part.vertexOffset + static_cast<uint64_t>(part.vertexCount) * header->vertexStride > m_file.Size()
+            || part.indexOffset + static_cast<uint64_t>(part.indexCount) * IndexSize(part.indexType) > m_file.Size()) {
+            return false;
+        }
+    }
+
+    m_header = header;
+    m_parts = parts;
+    m_lods = lods;
+    return true;
+}
+
+std::string_view MeshCache::MaterialName(size_t index) const
+{
+    return std::string_view(m_file.Data() + m_parts[index].materialNameOffset, m_parts[index].materialNameLength);
+}
+
+const void* MeshCache::VertexData(size_t index) const
+{
+    return m_file.Data() + m_parts[index].vertexOffset;
+}
+
+const void* MeshCache::IndexData(size_t index) const
+{
+    return m_file.Data() + m_parts[index].indexOffset;
+}
+
+size_t MeshCache::VertexBytes(size_t index) const
+{
+    return static_cast<size_t>(m_parts[index].vertexCount) * m_header->vertexStride;
+}
+
+size_t MeshCache::IndexBytes(size_t index) const
+{
+    return static_cast<size_t>(m_parts[index].indexCount) * IndexSize(m_parts[index].indexType);
+}
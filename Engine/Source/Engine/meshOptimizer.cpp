@@ -0,0 +1,350 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+    // Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+    constexpr size_t MAX_SCORED_VALENCE = 32;
+
+    struct ForsythScores {
+        float cache[MeshOptimizer::FORSYTH_CACHE_SIZE];
+        float valence[MAX_SCORED_VALENCE + 1];
+
+        ForsythScores()
+        {
+            constexpr size_t size = MeshOptimizer::FORSYTH_CACHE_SIZE;
+            for (size_t i = 0; i < size; ++i) {
+                // The three vertices of the last triangle get a fixed score so it is not simply repeated
+                cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - static_cast<float>(i - 3) / (size - 3), CACHE_DECAY_POWER);
+            }
+            valence[0] = 0.0f;
+            for (size_t i = 1; i <= MAX_SCORED_VALENCE; ++i) {
+                valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+            }
+        }
+
+        float Score(int32_t cachePosition, uint32_t remainingTriangles) const
+        {
+            if (remainingTriangles == 0) {
+                return -1.0f;
+            }
+            float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+            return score + valence[std::min<size_t>(remainingTriangles, MAX_SCORED_VALENCE)];
+        }
+    };
+
+}
+
+size_t MeshOptimizer::MergePartsByMaterial(ObjData& data)
+{
+    std::unordered_map<std::string, size_t> groupByMaterial;
+    std::vector<std::vector<size_t>> groups;
+    for (size_t i = 0; i < data.parts.size(); ++i) {
+        auto inserted = groupByMaterial.emplace(data.parts[i].materialName, groups.size());
+        if (inserted.second) {
+            groups.emplace_back();
+        }
+        groups[inserted.first->second].push_back(i);
+    }
+
+    size_t removed = data.parts.size() - groups.size();
+    if (removed == 0) {
+        return 0;
+    }
+
+    std::vector<ObjCorner> corners;
+    corners.reserve(data.corners.size());
+    std::vector<ObjPartRange> parts;
+    parts.reserve(groups.size());
+
+    for (const std::vector<size_t>& group : groups) {
+        ObjPartRange merged;
+        merged.materialName = data.parts[group.front()].materialName;
+        merged.firstFace = corners.size() / 3;
+        for (size_t index : group) {
+            const ObjPartRange& range = data.parts[index];
+            auto first = data.corners.begin() + range.firstFace * 3;
+            corners.insert(corners.end(), first, first + range.faceCount * 3);
+            merged.faceCount += range.faceCount;
+        }
+        parts.push_back(std::move(merged));
+    }
+
+    data.corners = std::move(corners);
+    data.parts = std::move(parts);
+    return removed;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    static const ForsythScores scores;
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Triangles using each vertex, packed back to back; the first `remaining[v]` entries are not emitted yet
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacencyOffsets[index + 1]++;
+    }
+    for (size_t i = 0; i < vertexCount; ++i) {
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        uint32_t vertex = indices[i];
+        adjacency[adjacencyOffsets[vertex] + remaining[vertex]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        vertexScore[i] = scores.Score(-1, remaining[i]);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    size_t scanCursor = 0;
+    uint32_t best = UINT32_MAX;
+
+    while (result.size() < triangleCount * 3) {
+        if (best == UINT32_MAX) {
+            // Dead end: no vertex in the cache has triangles left, so restart at the next unemitted one
+            while (emitted[scanCursor]) {
+                scanCursor++;
+            }
+            best = static_cast<uint32_t>(scanCursor);
+        }
+
+        emitted[best] = true;
+        const uint32_t* triangle = &indices[best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+
+        nextCache.clear();
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t vertex = triangle[k];
+            uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+            uint32_t* end = begin + remaining[vertex];
+            uint32_t* found = std::find(begin, end, best);
+            if (found != end) {
+                std::swap(*found, *(end - 1));
+                remaining[vertex]--;
+            }
+            if (std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()) {
+                nextCache.push_back(vertex);
+            }
+        }
+        for (uint32_t vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        // Vertices pushed past the end of the cache fall out of it
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            uint32_t vertex = nextCache[i];
+            cachePosition[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+            vertexScore[vertex] = scores.Score(cachePosition[vertex], remaining[vertex]);
+        }
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+
+        // Only triangles touching the cache changed score, so the next pick is among them
+        best = UINT32_MAX;
+        float bestScore = -1.0f;
+        for (uint32_t vertex : cache) {
+            const uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+            for (const uint32_t* it = begin; it != begin + remaining[vertex]; ++it) {
+                const uint32_t* candidate = &indices[*it * 3];
+                float score = vertexScore[candidate[0]] + vertexScore[candidate[1]] + vertexScore[candidate[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = *it;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float acmrThreshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+    std::vector<uint32_t> cacheTime(vertices.size(), 0);
+    uint32_t timestamp = FIFO_CACHE_SIZE + 1;
+    auto countMisses = [&](size_t triangle) {
+        size_t misses = 0;
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t vertex = indices[triangle * 3 + k];
+            if (timestamp - cacheTime[vertex] > FIFO_CACHE_SIZE) {
+                cacheTime[vertex] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    auto flushCache = [&]() { timestamp += FIFO_CACHE_SIZE + 1; };
+
+    // Hard boundaries: triangles where the cache flushed anyway because all three vertices missed
+    std::vector<size_t> hardStarts;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (countMisses(t) == 3 || t == 0) {
+            hardStarts.push_back(t);
+        }
+    }
+    hardStarts.push_back(triangleCount);
+
+    // Soft boundaries: split each hard cluster wherever the triangles so far, drawn from a cold cache,
+    // are within the threshold of the whole cluster's cold ACMR, so every cluster can be drawn in any order
+    std::vector<size_t> clusterStarts;
+    for (size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+        size_t begin = hardStarts[h];
+        size_t end = hardStarts[h + 1];
+
+        flushCache();
+        size_t hardMisses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            hardMisses += countMisses(t);
+        }
+        double targetAcmr = acmrThreshold * static_cast<double>(hardMisses) / (end - begin);
+
+        flushCache();
+        clusterStarts.push_back(begin);
+        size_t clusterStart = begin;
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t + 1 < end; ++t) {
+            clusterMisses += countMisses(t);
+            if (static_cast<double>(clusterMisses) / (t + 1 - clusterStart) <= targetAcmr) {
+                clusterStarts.push_back(t + 1);
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                flushCache();
+            }
+        }
+    }
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+
+    // Area-weighted centroid and normal of every cluster and of the whole mesh
+    struct Cluster {
+        size_t firstTriangle;
+        size_t triangleCount;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        Cluster& cluster = clusters[c];
+        cluster.firstTriangle = clusterStarts[c];
+        cluster.triangleCount = (c + 1 < clusters.size() ? clusterStarts[c + 1] : triangleCount) - cluster.firstTriangle;
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+        float area = 0.0f;
+
+        for (size_t t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.triangleCount; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(normal);
+            cluster.centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            cluster.normal += normal;
+            area += triangleArea;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += area;
+        cluster.centroid = area > 0.0f ? cluster.centroid / area : vertices[indices[cluster.firstTriangle * 3]].position;
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the centre are the outer shell and tend to occlude the rest
+    for (Cluster& cluster : clusters) {
+        float length = glm::length(cluster.normal);
+        cluster.sortKey = length > 0.0f ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / length) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        auto first = indices.begin() + cluster.firstTriangle * 3;
+        result.insert(result.end(), first, first + cluster.triangleCount * 3);
+    }
+
+    if (AnalyzeVertexCache(result, vertices.size()).Acmr() <= before.Acmr() * acmrThreshold) {
+        indices.swap(result);
+    }
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices)
+{
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    // Vertices no index refers to are dropped
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+    stats.vertices = vertexCount;
+
+    // A vertex is in the FIFO while fewer than `cacheSize` misses happened since it was inserted
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = static_cast<uint32_t>(cacheSize) + 1;
+    for (uint32_t index : indices) {
+        if (timestamp - cacheTime[index] > cacheSize) {
+            cacheTime[index] = timestamp++;
+            stats.transformedVertices++;
+        }
+    }
+
+    return stats;
+}
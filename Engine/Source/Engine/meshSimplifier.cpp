@@ -0,0 +1,245 @@
+#include "meshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+    // Symmetric 4x4 matrix summing squared distances to the planes of the triangles around a vertex,
+    // weighted by triangle area
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+        double weight = 0;
+
+        void AddPlane(const glm::dvec3& n, double d, double w)
+        {
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+            a22 += w * n.z * n.z; a23 += w * n.z * d;
+            a33 += w * d * d;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            weight += other.weight;
+            return *this;
+        }
+
+        double Evaluate(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                + a22 * z * z + 2 * a23 * z
+                + a33;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    // Mean squared distance the surface around both vertices moves when `from` is pulled onto `to`
+    double CollapseCost(const Quadric& from, const Quadric& to, const glm::vec3& target)
+    {
+        Quadric merged = from;
+        merged += to;
+        double cost = merged.weight > 0.0 ? merged.Evaluate(target) / merged.weight : 0.0;
+        return std::max(cost, 0.0);
+    }
+
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t targetIndexCount, float maxError, float& error)
+{
+    size_t vertexCount = vertices.size();
+    error = 0.0f;
+
+    // Weld vertices by position: copies split by a UV or normal seam share one id
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    auto positionLess = [&](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = vertices[a].position;
+        const glm::vec3& pb = vertices[b].position;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    };
+    std::sort(order.begin(), order.end(), positionLess);
+
+    std::vector<uint32_t> weld(vertexCount);
+    std::vector<uint8_t> locked(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; ) {
+        size_t end = i + 1;
+        while (end < vertexCount && vertices[order[end]].position == vertices[order[i]].position) {
+            end++;
+        }
+        for (size_t j = i; j < end; ++j) {
+            weld[order[j]] = order[i];
+            // Moving one copy of a seam vertex would tear the seam open
+            locked[order[j]] = end - i > 1;
+        }
+        i = end;
+    }
+
+    // Open borders are edges of the welded mesh used by a single triangle
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t a = weld[indices[t + k]];
+            uint32_t b = weld[indices[t + (k + 1) % 3]];
+            edgeUses[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)]++;
+        }
+    }
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t a = indices[t + k];
+            uint32_t b = indices[t + (k + 1) % 3];
+            uint64_t key = (static_cast<uint64_t>(std::min(weld[a], weld[b])) << 32) | std::max(weld[a], weld[b]);
+            if (edgeUses[key] == 1) {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        glm::dvec3 p0 = vertices[indices[t + 0]].position;
+        glm::dvec3 p1 = vertices[indices[t + 1]].position;
+        glm::dvec3 p2 = vertices[indices[t + 2]].position;
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length == 0.0) {
+            continue;
+        }
+        normal /= length;
+        double d = -glm::dot(normal, p0);
+        for (size_t k = 0; k < 3; ++k) {
+            quadrics[indices[t + k]].AddPlane(normal, d, length * 0.5);
+        }
+    }
+
+    std::vector<uint32_t> result = indices;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    double maxCost = static_cast<double>(maxError) * maxError;
+    double worstCost = 0.0;
+
+    // Each pass collapses a set of edges whose neighbourhoods do not overlap, then rebuilds the topology
+    while (result.size() > targetIndexCount) {
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+        for (uint32_t index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (size_t i = 0; i < vertexCount; ++i) {
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        }
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < result.size(); t += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t a = result[t + k];
+                uint32_t b = result[t + (k + 1) % 3];
+                if (!locked[a]) {
+                    collapses.push_back({ a, b, CollapseCost(quadrics[a], quadrics[b], vertices[b].position) });
+                }
+                if (!locked[b]) {
+                    collapses.push_back({ b, a, CollapseCost(quadrics[b], quadrics[a], vertices[a].position) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        size_t applied = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || removedTriangles >= std::max<size_t>(trianglesToRemove, 1)) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // Reject collapses that fold a surviving triangle over
+            const uint32_t* begin = adjacency.data() + adjacencyOffsets[collapse.from];
+            const uint32_t* end = adjacency.data() + adjacencyOffsets[collapse.from + 1];
+            size_t collapsing = 0;
+            bool flips = false;
+            for (const uint32_t* it = begin; it != end && !flips; ++it) {
+                const uint32_t* triangle = &result[*it * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    collapsing++;
+                    continue;
+                }
+                glm::vec3 p[3];
+                glm::vec3 moved[3];
+                for (size_t k = 0; k < 3; ++k) {
+                    p[k] = vertices[triangle[k]].position;
+                    moved[k] = triangle[k] == collapse.from ? vertices[collapse.to].position : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) <= MIN_NORMAL_COSINE * glm::length(before) * glm::length(after);
+            }
+            if (flips || collapsing == 0) {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            for (const uint32_t* it = begin; it != end; ++it) {
+                const uint32_t* triangle = &result[*it * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+            removedTriangles += collapsing;
+            worstCost = std::max(worstCost, collapse.cost);
+            applied++;
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < result.size(); t += 3) {
+            uint32_t a = remap[result[t]];
+            uint32_t b = remap[result[t + 1]];
+            uint32_t c = remap[result[t + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    error = static_cast<float>(std::sqrt(worstCost));
+    return result;
+}
@@ -0,0 +1,506 @@
+#include "mipGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <glad/glad.h>
+
+#include "hash.h"
+#include "ktxFile.h"
+#include "mappedFile.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MIP_GENERATOR_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need AVX2 enabled per function; MSVC accepts the intrinsics anywhere
+#if defined(MIP_GENERATOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MIP_GENERATOR_AVX2 __attribute__((target("avx2")))
+#else
+#define MIP_GENERATOR_AVX2
+#endif
+
+namespace {
+
+    constexpr float PI = 3.14159265358979f;
+    constexpr int LINEAR_TO_SRGB_STEPS = 4096;
+
+    // Linear float RGBA, rows top to bottom
+    struct LinearImage {
+        int width = 0;
+        int height = 0;
+        std::vector<float> texels;
+    };
+
+    // Source texels and weights of every output texel along one axis; every output has `count` taps
+    struct FilterTaps {
+        int count = 0;
+        std::vector<int> indices;
+        std::vector<float> weights;
+    };
+
+    struct ColorTables {
+        float srgbToLinear[256];
+        unsigned char linearToSrgb[LINEAR_TO_SRGB_STEPS];
+
+        ColorTables()
+        {
+            for (int i = 0; i < 256; ++i) {
+                float c = i / 255.0f;
+                srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < LINEAR_TO_SRGB_STEPS; ++i) {
+                float l = i / static_cast<float>(LINEAR_TO_SRGB_STEPS - 1);
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                linearToSrgb[i] = static_cast<unsigned char>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+            }
+        }
+    };
+
+    const ColorTables& Tables()
+    {
+        static const ColorTables tables;
+        return tables;
+    }
+
+    float Sinc(float x)
+    {
+        if (std::abs(x) < 1e-5f) {
+            return 1.0f;
+        }
+        return std::sin(PI * x) / (PI * x);
+    }
+
+    float BesselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int k = 1; k < 16; ++k) {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    float FilterRadius(MipFilter filter)
+    {
+        return filter == MipFilter::Box ? 0.5f : 3.0f;
+    }
+
+    float FilterWeight(MipFilter filter, float x)
+    {
+        x = std::abs(x);
+        switch (filter) {
+        case MipFilter::Box:
+            return x < 0.5f ? 1.0f : 0.0f;
+        case MipFilter::Kaiser: {
+            constexpr float width = 3.0f;
+            constexpr float alpha = 4.0f;
+            if (x >= width) {
+                return 0.0f;
+            }
+            float t = x / width;
+            return Sinc(x) * BesselI0(alpha * std::sqrt(1.0f - t * t)) / BesselI0(alpha);
+        }
+        case MipFilter::Lanczos:
+            return x < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+        }
+        return 0.0f;
+    }
+
+    // Taps for shrinking `inSize` texels to `outSize`; samples past the edge clamp to it
+    FilterTaps BuildTaps(MipFilter filter, int inSize, int outSize)
+    {
+        float scale = static_cast<float>(inSize) / outSize;
+        float support = FilterRadius(filter) * scale;
+
+        // Texel j contributes when its center j + 0.5 lies strictly inside the support
+        auto firstTap = [&](int i) { return static_cast<int>(std::floor((i + 0.5f) * scale - support - 0.5f)) + 1; };
+        auto lastTap = [&](int i) { return static_cast<int>(std::ceil((i + 0.5f) * scale + support - 0.5f)) - 1; };
+
+        FilterTaps taps;
+        for (int i = 0; i < outSize; ++i) {
+            taps.count = std::max(taps.count, lastTap(i) - firstTap(i) + 1);
+        }
+        taps.indices.resize(static_cast<size_t>(outSize) * taps.count);
+        taps.weights.resize(static_cast<size_t>(outSize) * taps.count);
+
+        for (int i = 0; i < outSize; ++i) {
+            float center = (i + 0.5f) * scale;
+            int first = firstTap(i);
+            int* indices = &taps.indices[static_cast<size_t>(i) * taps.count];
+            float* weights = &taps.weights[static_cast<size_t>(i) * taps.count];
+
+            float total = 0.0f;
+            for (int t = 0; t < taps.count; ++t) {
+                int source = first + t;
+                indices[t] = std::clamp(source, 0, inSize - 1);
+                weights[t] = FilterWeight(filter, (source + 0.5f - center) / scale);
+                total += weights[t];
+            }
+            for (int t = 0; t < taps.count; ++t) {
+                weights[t] /= total;
+            }
+        }
+
+        return taps;
+    }
+
+    LinearImage ToLinear(const ImageData& image, bool gammaCorrect)
+    {
+        const ColorTables& tables = Tables();
+        LinearImage linear;
+        linear.width = image.width;
+        linear.height = image.height;
+        size_t count = static_cast<size_t>(image.width) * image.height;
+        linear.texels.resize(count * 4);
+
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned char* source = &image.pixels[i * image.channels];
+            float* target = &linear.texels[i * 4];
+            for (int c = 0; c < 3; ++c) {
+                target[c] = gammaCorrect ? tables.srgbToLinear[source[c]] : source[c] / 255.0f;
+            }
+            target[3] = image.channels == 4 ? source[3] / 255.0f : 1.0f;
+        }
+
+        return linear;
+    }
+
+    unsigned char Quantize(float value, bool encodeSrgb)
+    {
+        float clamped = std::clamp(value, 0.0f, 1.0f);
+        if (encodeSrgb) {
+            return Tables().linearToSrgb[static_cast<int>(clamped * (LINEAR_TO_SRGB_STEPS - 1) + 0.5f)];
+        }
+        return static_cast<unsigned char>(clamped * 255.0f + 0.5f);
+    }
+
+    ImageData ToImage(const LinearImage& linear, bool gammaCorrect)
+    {
+        ImageData image;
+        image.width = linear.width;
+        image.height = linear.height;
+        image.channels = 4;
+        image.pixels.resize(linear.texels.size());
+
+        for (size_t i = 0; i < linear.texels.size(); i += 4) {
+            for (int c = 0; c < 3; ++c) {
+                image.pixels[i + c] = Quantize(linear.texels[i + c], gammaCorrect);
+            }
+            image.pixels[i + 3] = Quantize(linear.texels[i + 3], false);
+        }
+
+        return image;
+    }
+
+    // Scalar reference: horizontal pass into a width-reduced image, then the vertical pass
+    LinearImage DownsampleScalar(const LinearImage& source, const FilterTaps& horizontal, const FilterTaps& vertical, int width, int height)
+    {
+        std::vector<float> rows(static_cast<size_t>(width) * source.height * 4);
+        for (int y = 0; y < source.height; ++y) {
+            const float* row = &source.texels[static_cast<size_t>(y) * source.width * 4];
+            for (int x = 0; x < width; ++x) {
+                float sum[4] = {};
+                for (int t = 0; t < horizontal.count; ++t) {
+                    size_t tap = static_cast<size_t>(x) * horizontal.count + t;
+                    const float* texel = row + static_cast<size_t>(horizontal.indices[tap]) * 4;
+                    for (int c = 0; c < 4; ++c) {
+                        sum[c] += texel[c] * horizontal.weights[tap];
+                    }
+                }
+                std::copy(sum, sum + 4, &rows[(static_cast<size_t>(y) * width + x) * 4]);
+            }
+        }
+
+        LinearImage level;
+        level.width = width;
+        level.height = height;
+        level.texels.assign(static_cast<size_t>(width) * height * 4, 0.0f);
+        size_t rowFloats = static_cast<size_t>(width) * 4;
+        for (int y = 0; y < height; ++y) {
+            float* target = &level.texels[y * rowFloats];
+            for (int t = 0; t < vertical.count; ++t) {
+                size_t tap = static_cast<size_t>(y) * vertical.count + t;
+                const float* row = &rows[vertical.indices[tap] * rowFloats];
+                float weight = vertical.weights[tap];
+                for (size_t i = 0; i < rowFloats; ++i) {
+                    target[i] += row[i] * weight;
+                }
+            }
+        }
+
+        return level;
+    }
+
+#ifdef MIP_GENERATOR_X86
+
+    bool CpuHasAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5));
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    // One RGBA texel per SSE register: each output texel is a weighted sum of whole texels
+    void HorizontalSse(const LinearImage& source, const FilterTaps& horizontal, int width, std::vector<float>& rows)
+    {
+        for (int y = 0; y < source.height; ++y) {
+            const float* row = &source.texels[static_cast<size_t>(y) * source.width * 4];
+            float* target = &rows[static_cast<size_t>(y) * width * 4];
+            for (int x = 0; x < width; ++x) {
+                const int* indices = &horizontal.indices[static_cast<size_t>(x) * horizontal.count];
+                const float* weights = &horizontal.weights[static_cast<size_t>(x) * horizontal.count];
+                __m128 sum = _mm_setzero_ps();
+                for (int t = 0; t < horizontal.count; ++t) {
+                    __m128 texel = _mm_loadu_ps(row + static_cast<size_t>(indices[t]) * 4);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weights[t])));
+                }
+                _mm_storeu_ps(target + static_cast<size_t>(x) * 4, sum);
+            }
+        }
+    }
+
+    void VerticalSse(const std::vector<float>& rows, const FilterTaps& vertical, LinearImage& level)
+    {
+        size_t rowFloats = static_cast<size_t>(level.width) * 4;
+        for (int y = 0; y < level.height; ++y) {
+            float* target = &level.texels[y * rowFloats];
+            for (int t = 0; t < vertical.count; ++t) {
+                size_t tap = static_cast<size_t>(y) * vertical.count + t;
+                const float* row = &rows[vertical.indices[tap] * rowFloats];
+                __m128 weight = _mm_set1_ps(vertical.weights[tap]);
+                // Rows are whole RGBA texels, so the float count is always a multiple of 4
+                for (size_t i = 0; i < rowFloats; i += 4) {
+                    __m128 sum = _mm_add_ps(_mm_loadu_ps(target + i), _mm_mul_ps(_mm_loadu_ps(row + i), weight));
+                    _mm_storeu_ps(target + i, sum);
+                }
+            }
+        }
+    }
+
+    // Two output texels per AVX register; an odd last texel falls back to a half-width step
+    MIP_GENERATOR_AVX2 void HorizontalAvx2(const LinearImage& source, const FilterTaps& horizontal, int width, std::vector<float>& rows)
+    {
+        for (int y = 0; y < source.height; ++y) {
+            const float* row = &source.texels[static_cast<size_t>(y) * source.width * 4];
+            float* target = &rows[static_cast<size_t>(y) * width * 4];
+            int x = 0;
+            for (; x + 1 < width; x += 2) {
+                const int* indices0 = &horizontal.indices[static_cast<size_t>(x) * horizontal.count];
+                const int* indices1 = indices0 + horizontal.count;
+                const float* weights0 = &horizontal.weights[static_cast<size_t>(x) * horizontal.count];
+                const float* weights1 = weights0 + horizontal.count;
+                __m256 sum = _mm256_setzero_ps();
+                for (int t = 0; t < horizontal.count; ++t) {
+                    __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(row + static_cast<size_t>(indices0[t]) * 4)),
+                        _mm_loadu_ps(row + static_cast<size_t>(indices1[t]) * 4), 1);
+                    __m256 weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights0[t])), _mm_set1_ps(weights1[t]), 1);
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(texels, weights));
+                }
+                _mm256_storeu_ps(target + static_cast<size_t>(x) * 4, sum);
+            }
+            for (; x < width; ++x) {
+                const int* indices = &horizontal.indices[static_cast<size_t>(x) * horizontal.count];
+                const float* weights = &horizontal.weights[static_cast<size_t>(x) * horizontal.count];
+                __m128 sum = _mm_setzero_ps();
+                for (int t = 0; t < horizontal.count; ++t) {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + static_cast<size_t>(indices[t]) * 4), _mm_set1_ps(weights[t])));
+                }
+                _mm_storeu_ps(target + static_cast<size_t>(x) * 4, sum);
+            }
+        }
+    }
+
+    MIP_GENERATOR_AVX2 void VerticalAvx2(const std::vector<float>& rows, const FilterTaps& vertical, LinearImage& level)
+    {
+        size_t rowFloats = static_cast<size_t>(level.width) * 4;
+        for (int y = 0; y < level.height; ++y) {
+            float* target = &level.texels[y * rowFloats];
+            for (int t = 0; t < vertical.count; ++t) {
+                size_t tap = static_cast<size_t>(y) * vertical.count + t;
+                const float* row = &rows[vertical.indices[tap] * rowFloats];
+                __m256 weight = _mm256_set1_ps(vertical.weights[tap]);
+                size_t i = 0;
+                for (; i + 8 <= rowFloats; i += 8) {
+                    __m256 sum = _mm256_add_ps(_mm256_loadu_ps(target + i), _mm256_mul_ps(_mm256_loadu_ps(row + i), weight));
+                    _mm256_storeu_ps(target + i, sum);
+                }
+                if (i < rowFloats) {
+                    __m128 sum = _mm_add_ps(_mm_loadu_ps(target + i), _mm_mul_ps(_mm_loadu_ps(row + i), _mm256_castps256_ps128(weight)));
+                    _mm_storeu_ps(target + i, sum);
+                }
+            }
+        }
+    }
+
+    LinearImage DownsampleSimd(const LinearImage& source, const FilterTaps& horizontal, const FilterTaps& vertical, int width, int height)
+    {
+        static const bool avx2 = CpuHasAvx2();
+
+        std::vector<float> rows(static_cast<size_t>(width) * source.height * 4);
+        LinearImage level;
+        level.width = width;
+        level.height = height;
+        level.texels.assign(static_cast<size_t>(width) * height * 4, 0.0f);
+
+        if (avx2) {
+            HorizontalAvx2(source, horizontal, width, rows);
+            VerticalAvx2(rows, vertical, level);
+        }
+        else {
+            HorizontalSse(source, horizontal, width, rows);
+            VerticalSse(rows, vertical, level);
+        }
+
+        return level;
+    }
+
+#endif
+
+    LinearImage Downsample(const LinearImage& source, MipFilter filter, bool useSimd)
+    {
+        int width = std::max(1, source.width / 2);
+        int height = std::max(1, source.height / 2);
+        FilterTaps horizontal = BuildTaps(filter, source.width, width);
+        FilterTaps vertical = BuildTaps(filter, source.height, height);
+
+#ifdef MIP_GENERATOR_X86
+        if (useSimd) {
+            return DownsampleSimd(source, horizontal, vertical, width, height);
+        }
+#else
+        (void)useSimd;
+#endif
+        return DownsampleScalar(source, horizontal, vertical, width, height);
+    }
+
+    ImageData ExpandToRgba(const ImageData& image)
+    {
+        if (image.channels == 4) {
+            return image;
+        }
+
+        ImageData rgba;
+        rgba.width = image.width;
+        rgba.height = image.height;
+        rgba.channels = 4;
+        size_t count = static_cast<size_t>(image.width) * image.height;
+        rgba.pixels.resize(count * 4);
+        for (size_t i = 0; i < count; ++i) {
+            std::copy_n(&image.pixels[i * 3], 3, &rgba.pixels[i * 4]);
+            rgba.pixels[i * 4 + 3] = 255;
+        }
+        return rgba;
+    }
+
+}
+
+std::string MipGenerator::MipsPathFor(const std::string& imagePath)
+{
+    return imagePath + ".mips.ktx";
+}
+
+const char* MipGenerator::SimdPath()
+{
+#ifdef MIP_GENERATOR_X86
+    return CpuHasAvx2() ? "AVX2" : "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+std::vector<ImageData> MipGenerator::GenerateChain(const ImageData& image, const MipOptions& options)
+{
+    std::vector<ImageData> levels;
+    if (!image.IsValid()) {
+        return levels;
+    }
+
+    levels.push_back(ExpandToRgba(image));
+    LinearImage linear = ToLinear(image, options.gammaCorrect);
+    while (linear.width > 1 || linear.height > 1) {
+        linear = Downsample(linear, options.filter, options.useSimd);
+        levels.push_back(ToImage(linear, options.gammaCorrect));
+    }
+
+    return levels;
+}
+
+bool MipGenerator::Bake(const std::string& imagePath, const MipOptions& options)
+{
+    SourceStamp source;
+    MappedFile sourceFile(imagePath);
+    if (!sourceFile.IsOpen() || !SourceStamp::Describe(imagePath, source)) {
+        std::cerr << "Failed to open texture: " << imagePath << std::endl;
+        return false;
+    }
+    source.contentHash = Hash::Xxh64(sourceFile.Data(), sourceFile.Size());
+
+    ImageData image = ImageData::Load(imagePath);
+    if (!image.IsValid()) {
+        std::cerr << "Failed to load texture: " << imagePath << std::endl;
+        return false;
+    }
+
+    std::vector<ImageData> chain = GenerateChain(image, options);
+    std::vector<KtxLevel> levels(chain.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        levels[i].data = chain[i].pixels.data();
+        levels[i].size = chain[i].pixels.size();
+    }
+
+    KtxHeader header = KtxFile::MakeHeader(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, image.width, image.height);
+    if (!KtxFile::Write(MipsPathFor(imagePath), header, levels, source)) {
+        std::cerr << "Failed to write " << MipsPathFor(imagePath) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MipBenchmark MipGenerator::Benchmark(const ImageData& image, MipFilter filter, int iterations)
+{
+    MipBenchmark benchmark;
+    benchmark.simdPath = SimdPath();
+
+    std::vector<ImageData> chains[2];
+    double* timings[2] = { &benchmark.scalarMilliseconds, &benchmark.simdMilliseconds };
+    for (int path = 0; path < 2; ++path) {
+        MipOptions options;
+        options.filter = filter;
+        options.useSimd = path == 1;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            chains[path] = GenerateChain(image, options);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        *timings[path] = elapsed.count() / std::max(iterations, 1);
+    }
+
+    for (size_t level = 0; level < chains[0].size() && level < chains[1].size(); ++level) {
+        const std::vector<unsigned char>& scalar = chains[0][level].pixels;
+        const std::vector<unsigned char>& simd = chains[1][level].pixels;
+        for (size_t i = 0; i < scalar.size(); ++i) {
+            benchmark.maxDifference = std::max(benchmark.maxDifference, std::abs(scalar[i] - simd[i]));
+        }
+    }
+
+    return benchmark;
+}
@@ -3,9 +3,22 @@
 out vec4 FragColor;
 in vec2 TexCoord;
 
+layout (std140) uniform DrawUniforms
+{
+    mat4 model;
+    vec4 positionScale;
+    vec4 positionOffset;
+    ivec4 material; // x: layer of textureArray, -1 to sample texture1
+};
+
 uniform sampler2D texture1;
+// Materials packed into a texture array sample their layer of it instead
+uniform sampler2DArray textureArray;
 
 void main()
 {
-    FragColor = texture(texture1, TexCoord);
-}
\ No newline at end of file
+    if (material.x >= 0)
+        FragColor = texture(textureArray, vec3(TexCoord, material.x));
+    else
+        FragColor = texture(texture1, TexCoord);
+}
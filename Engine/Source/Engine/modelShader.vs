@@ -2,15 +2,38 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+#ifdef INSTANCED
+// Per-instance model matrix, locations 4 to 7; see RenderQueue::INSTANCE_LOCATION
+layout (location = 4) in mat4 aModel;
+#endif
 
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Filled once per camera and once per draw; see uniformBuffers.h for the C++ side
+layout (std140) uniform ViewUniforms
+{
+    mat4 projection;
+    mat4 view;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+layout (std140) uniform DrawUniforms
+{
+    mat4 model; // unused by the INSTANCED variant
+    // Dequantizes positions stored as normalized integers over the part bounds (identity for float positions)
+    vec4 positionScale;
+    vec4 positionOffset;
+    ivec4 material;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 world = aModel;
+#else
+    mat4 world = model;
+#endif
+    gl_Position = viewProjection * world * vec4(aPos * positionScale.xyz + positionOffset.xyz, 1.0);
     TexCoord = aTexCoord;
-}
\ No newline at end of file
+}
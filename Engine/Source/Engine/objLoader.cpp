@@ -1,43 +1,118 @@
 #include "objLoader.h"
 
 #include <memory>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
 #include <iostream>
-#include <fstream>
 #include <sstream>
-#include <stb_image.h>
 #include <glad/glad.h>
 #include <shaderHelper.h>
 #include <ext/matrix_clip_space.hpp>
 #include <GLFW/glfw3.h>
 
+#include "engineLog.h"
 #include "globals.h"
-
-ObjLoader::ObjLoader(std::string objFilePath, std::string mtlFilePath)
+#include "meshCache.h"
+#include "hash.h"
+#include "materialTable.h"
+#include "threadPool.h"
+#include "meshOptimizer.h"
+#include "meshSimplifier.h"
+#include "streamingPartBuilder.h"
+#include "textureCache.h"
+
+ObjLoader::ObjLoader(std::string objFilePath, std::string mtlFilePath, const MeshImportOptions& options, bool uploadNow)
 {
     m_objFilePath = objFilePath;
     m_mtlFilePath = mtlFilePath;
+    m_options = options;
 
     LoadMtlFile();
-	LoadObjFile();
+    DecodeTextures();
 
-    for (const auto& part : ModelParts) {
-        GLuint VAO, VBO;
-        SetupModelPartBuffers(part, VAO, VBO);
-        VAOS.push_back(VAO);
-        VBOS.push_back(VBO);
+    if (!OpenMeshCache()) {
+        if (m_options.streamUpload && uploadNow) {
+            StreamObjFile();
+        }
+        else {
+            LoadObjFile();
+            PackIndices();
+        }
+    }
+
+    WaitForTextures();
+
+    if (uploadNow) {
+        Upload();
+    }
+}
+
+bool ObjLoader::OpenMeshCache() {
+    if (!m_options.useMeshCache) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto cache = std::make_unique<MeshCache>();
+    if (!cache->Open(m_objFilePath, m_options)) {
+        return false;
+    }
+
+    ModelParts.resize(cache->PartCount());
+    for (size_t i = 0; i < cache->PartCount(); ++i) {
+        const GMeshPart& entry = cache->Part(i);
+        ModelPart& part = ModelParts[i];
+        part.vertexCount = entry.vertexCount;
+        part.indexCount = entry.indexCount;
+        part.indexType = entry.indexType;
+        part.materialName = cache->MaterialName(i);
+        part.boundsMin = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        part.boundsMax = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+        part.uvDensity = entry.uvDensity;
+        part.vertexFormat = cache->Format();
+        part.lods.clear();
+        for (size_t l = 0; l < entry.lodCount; ++l) {
+            const GMeshLod& lod = cache->Lod(entry.lodFirst + l);
+            part.lods.push_back({ lod.firstIndex, lod.indexCount, lod.error });
+        }
+        part.dequantization = VertexFormats::Dequantization(part.vertexFormat, part.boundsMin, part.boundsMax);
+    }
+    m_meshCache = std::move(cache);
+
+    std::chrono::duration<double, std::milli> milliseconds = std::chrono::steady_clock::now() - start;
+    if (EngineLog::Verbose) {
+        std::cout << "Mapped '" << MeshCache::CachePathFor(m_objFilePath) << "' in " << milliseconds.count() << " ms\n";
+    }
+    return true;
+}
+
+void ObjLoader::WriteMeshCache(const VfsFile& sourceFile) {
+    // A source read from an archive has nowhere to put its cache; the archive ships the .gmesh
+    SourceStamp source;
+    if (sourceFile.IsArchived() || !SourceStamp::Describe(m_objFilePath, source)) {
+        return;
+    }
+    source.contentHash = Hash::Xxh64(sourceFile.Data(), sourceFile.Size());
+
+    if (!MeshCache::Write(m_objFilePath, source, m_options, ModelParts)) {
+        std::cerr << "Failed to write mesh cache: " << MeshCache::CachePathFor(m_objFilePath) << std::endl;
     }
 }
 
 void ObjLoader::LoadMtlFile() {
     std::unordered_map<std::string, Material> materials;
-    std::ifstream file(m_mtlFilePath);
-
-    if (!file.is_open()) {
+    std::string text;
+    if (!Vfs::Shared().ReadText(m_mtlFilePath, text)) {
         std::cerr << "Failed to open MTL file: " << m_mtlFilePath << std::endl;
         MaterialData = materials;
         return;
     }
 
+    std::istringstream file(text);
     Material currentMaterial;
     std::string line;
     while (std::getline(file, line)) {
@@ -45,8 +120,6 @@ void ObjLoader::LoadMtlFile() {
         std::string type;
         iss >> type;
 
-        unsigned int textureID = 0;
-
         if (type == "newmtl") {
             if (currentMaterial.diffuseMap != "") {
                 materials[currentMaterial.diffuseMap] = currentMaterial;
@@ -68,11 +141,8 @@ void ObjLoader::LoadMtlFile() {
         }
         else if (type == "map_Kd") {
             iss >> currentMaterial.diffuseTexture;
-            int width, height, nrChannels;
             std::string img = "../Engine/Source/Engine/Images/" + currentMaterial.diffuseTexture;
-            textureID++;
-            LoadTexture(width, height, nrChannels, textureID, img.c_str(), false);
-            currentMaterial.textureID = textureID;
+            m_pendingTextures.push_back({ currentMaterial.diffuseMap, img });
         }
     }
 
@@ -84,151 +154,551 @@ void ObjLoader::LoadMtlFile() {
     return;
 }
 
+void ObjLoader::DecodeTextures() {
+    if (!m_options.decodeTextures) {
+        return;
+    }
+
+    // One pool task per image, so the decodes overlap each other and the OBJ import that follows
+    std::unordered_set<std::string> submitted;
+    m_textureDecodeStart = std::chrono::steady_clock::now();
+    for (const PendingTexture& pending : m_pendingTextures) {
+        if (submitted.insert(pending.imagePath).second) {
+            std::string imagePath = pending.imagePath;
+            bool asLayer = m_options.textureArrays;
+            m_textureDecodes.push_back(ThreadPool::Shared().Submit([imagePath, asLayer]() {
+                TextureCache::Shared().Prefetch(imagePath, TextureSampler(), asLayer);
+            }));
+        }
+    }
+}
+
+void ObjLoader::WaitForTextures() {
+    if (m_textureDecodes.empty()) {
+        return;
+    }
+
+    auto waitStart = std::chrono::steady_clock::now();
+    for (std::future<void>& decode : m_textureDecodes) {
+        ThreadPool::Shared().WaitFor(decode);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> total = end - m_textureDecodeStart;
+    std::chrono::duration<double, std::milli> waited = end - waitStart;
+    if (EngineLog::Verbose) {
+        std::cout << "Decoded " << m_textureDecodes.size() << " textures for '" << m_objFilePath << "' in " << total.count()
+            << " ms, " << waited.count() << " ms of it after the geometry was ready\n";
+    }
+    m_textureDecodes.clear();
+}
+
 void ObjLoader::LoadObjFile() {
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> temp_vertices, temp_normals;
-    std::vector<glm::vec2> temp_uvs;
-    std::string currentMaterialName;
-    ModelPart* currentModelPart = nullptr;
-
-    FILE* file = nullptr;
-    errno_t err = fopen_s(&file, m_objFilePath.c_str(), "r");
-    std::unique_ptr<FILE, decltype(&fclose)> file_ptr(file, &fclose);
-    if (err != 0 || !file_ptr) {
-        std::cerr << "The file '" << m_objFilePath << "' could not be opened\n";
+    VfsFile file(m_objFilePath);
+    if (!file.IsOpen()) {
+        m_error = "could not be opened";
+        std::cerr << "The file '" << m_objFilePath << "' " << m_error << "\n";
         return;
     }
 
-    char line[128];
+    auto start = std::chrono::steady_clock::now();
 
-    while (fgets(line, sizeof(line), file_ptr.get())) {
-        if (strncmp(line, "v ", 2) == 0) {
-            glm::vec3 vertex;
-            if (sscanf_s(line + 2, "%f %f %f", &vertex.x, &vertex.y, &vertex.z) == 3) {
-                temp_vertices.push_back(vertex);
-            }
+    ObjData data;
+    std::string error;
+    if (!ObjParser::Parse(file.Data(), file.End(), data, error, m_options.parseThreads)) {
+        m_error = error;
+        std::cerr << "File can't be read by our simple parser. Try exporting with other options. (" << m_objFilePath << ", " << error << ")\n";
+        return;
+    }
+
+    // A partial model must never reach the cache, where its fresh stamp would keep it forever
+    if (!BuildModelParts(data)) {
+        ModelParts.clear();
+        return;
+    }
+    PackVertices();
+
+    if (m_options.useMeshCache) {
+        WriteMeshCache(file);
+    }
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    double megabytes = file.Size() / (1024.0 * 1024.0);
+    if (EngineLog::Verbose) {
+        std::cout << "Parsed '" << m_objFilePath << "': " << megabytes << " MB in " << seconds.count() * 1000.0 << " ms ("
+            << (seconds.count() > 0.0 ? megabytes / seconds.count() : 0.0) << " MB/s)\n";
+    }
+}
+
+void ObjLoader::StreamObjFile() {
+    VfsFile file(m_objFilePath);
+    if (!file.IsOpen()) {
+        m_error = "could not be opened";
+        std::cerr << "The file '" << m_objFilePath << "' " << m_error << "\n";
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    ObjData data;
+    std::string error;
+    if (!ObjParser::ParseAttributes(file.Data(), file.End(), data, error, m_options.parseThreads)) {
+        m_error = error;
+        std::cerr << "File can't be read by our simple parser. Try exporting with other options. (" << m_objFilePath << ", " << error << ")\n";
+        return;
+    }
+
+    // One part per material, as after MeshOptimizer::MergePartsByMaterial, without moving any faces
+    std::unordered_map<std::string, size_t> partByMaterial;
+    std::vector<size_t> partOfRange(data.parts.size());
+    std::vector<size_t> faceCounts;
+    for (size_t i = 0; i < data.parts.size(); ++i) {
+        auto inserted = partByMaterial.emplace(data.parts[i].materialName, ModelParts.size());
+        if (inserted.second) {
+            ModelParts.emplace_back().materialName = data.parts[i].materialName;
+            faceCounts.push_back(0);
         }
-        else if (strncmp(line, "vt ", 3) == 0) {
-            glm::vec2 uv;
-            if (sscanf_s(line + 3, "%f %f", &uv.x, &uv.y) == 2) {
-                // Invert V coordinate to conform with OpenGL standards
-                uv.y = 1.0f - uv.y;
-                temp_uvs.push_back(uv);
+        partOfRange[i] = inserted.first->second;
+        faceCounts[partOfRange[i]] += data.parts[i].faceCount;
+    }
+
+    // Part bounds are only known once streamed, so quantized positions use the bounds of the whole pool
+    glm::vec3 poolMin(std::numeric_limits<float>::max());
+    glm::vec3 poolMax(-std::numeric_limits<float>::max());
+    for (const glm::vec3& position : data.positions) {
+        poolMin = glm::min(poolMin, position);
+        poolMax = glm::max(poolMax, position);
+    }
+    PositionDequantization dequantization = VertexFormats::Dequantization(m_options.vertexFormat, poolMin, poolMax);
+
+    std::vector<std::unique_ptr<StreamingPartBuilder>> builders;
+    for (size_t faceCount : faceCounts) {
+        builders.push_back(std::make_unique<StreamingPartBuilder>(faceCount, m_options.vertexFormat, dequantization, m_options.streamChunkBytes));
+    }
+
+    bool streamed = ObjParser::ForEachFace(file.Data(), file.End(), [&](size_t range, const ObjCorner* corners) {
+        for (size_t k = 0; k < 3; ++k) {
+            if (corners[k].position >= data.positions.size() || corners[k].uv >= data.uvs.size() || corners[k].normal >= data.normals.size()) {
+                error = "references a vertex that does not exist";
+                return false;
             }
         }
-        else if (strncmp(line, "vn ", 3) == 0) {
-            glm::vec3 normal;
-            if (sscanf_s(line + 3, "%f %f %f", &normal.x, &normal.y, &normal.z) == 3) {
-                temp_normals.push_back(normal);
+        if (!builders[partOfRange[range]]->AddTriangle(data, corners)) {
+            error = "a GL buffer could not be mapped";
+            return false;
+        }
+        return true;
+    }, error);
+
+    if (!streamed) {
+        m_error = error;
+        std::cerr << "The file '" << m_objFilePath << "' could not be streamed (" << error << ")\n";
+        ModelParts.clear();
+        return;
+    }
+
+    size_t vertexCount = 0;
+    for (size_t i = 0; i < ModelParts.size(); ++i) {
+        GLuint VAO, VBO, EBO;
+        builders[i]->Finish(ModelParts[i], VAO, VBO, EBO);
+        VAOS.push_back(VAO);
+        VBOS.push_back(VBO);
+        EBOS.push_back(EBO);
+        vertexCount += ModelParts[i].vertexCount;
+    }
+    m_uploadedParts = ModelParts.size();
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    double megabytes = file.Size() / (1024.0 * 1024.0);
+    if (EngineLog::Verbose) {
+        std::cout << "Streamed '" << m_objFilePath << "': " << megabytes << " MB in " << seconds.count() * 1000.0 << " ms ("
+            << (seconds.count() > 0.0 ? megabytes / seconds.count() : 0.0) << " MB/s), " << ModelParts.size() << " parts, "
+            << vertexCount << " vertices, " << m_options.streamChunkBytes / 1024 << " KB windows\n";
+    }
+}
+
+bool ObjLoader::BuildModelParts(ObjData& data) {
+    for (const ObjCorner& corner : data.corners) {
+        if (corner.position >= data.positions.size() || corner.uv >= data.uvs.size() || corner.normal >= data.normals.size()) {
+            m_error = "references a vertex that does not exist";
+            std::cerr << "The file '" << m_objFilePath << "' " << m_error << "\n";
+            return false;
+        }
+    }
+
+    size_t sourceParts = data.parts.size();
+    if (m_options.optimizeMeshes) {
+        MeshOptimizer::MergePartsByMaterial(data);
+    }
+
+    ModelParts.resize(data.parts.size());
+    // The cache simulation only feeds the statistics line
+    bool logStats = EngineLog::Verbose;
+    std::vector<VertexCacheStats> cacheBefore(ModelParts.size());
+    std::vector<VertexCacheStats> cacheAfter(ModelParts.size());
+
+    ThreadPool::Shared().ParallelFor(data.parts.size(), [&](size_t i) {
+        const ObjPartRange& range = data.parts[i];
+        ModelPart& part = ModelParts[i];
+        part.materialName = range.materialName;
+        BuildIndexedGeometry(data, data.corners.data() + range.firstFace * 3, range.faceCount * 3, part);
+
+        if (logStats) {
+            cacheBefore[i] = MeshOptimizer::AnalyzeVertexCache(part.indices, part.vertexCount);
+        }
+        if (m_options.optimizeMeshes) {
+            MeshOptimizer::OptimizeVertexCache(part.indices, part.vertexCount);
+            MeshOptimizer::OptimizeOverdraw(part.indices, part.vertices);
+        }
+        if (logStats) {
+            cacheAfter[i] = MeshOptimizer::AnalyzeVertexCache(part.indices, part.vertexCount);
+        }
+
+        BuildLodChain(part);
+        if (m_options.optimizeMeshes) {
+            MeshOptimizer::OptimizeVertexFetch(part.indices, part.vertices);
+            part.vertexCount = static_cast<unsigned int>(part.vertices.size());
+        }
+    });
+
+    size_t expandedVertices = data.corners.size();
+    size_t uniqueVertices = 0;
+    size_t indexBytes = 0;
+    size_t lodCount = 0;
+    size_t lodTriangles = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+    for (size_t i = 0; i < ModelParts.size(); ++i) {
+        const ModelPart& part = ModelParts[i];
+        uniqueVertices += part.vertexCount;
+        indexBytes += part.indices.size() * (part.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+        lodCount += part.lods.size() - 1;
+        lodTriangles += part.lods.back().indexCount / 3;
+        before.triangles += cacheBefore[i].triangles;
+        before.vertices += cacheBefore[i].vertices;
+        before.transformedVertices += cacheBefore[i].transformedVertices;
+        after.triangles += cacheAfter[i].triangles;
+        after.vertices += cacheAfter[i].vertices;
+        after.transformedVertices += cacheAfter[i].transformedVertices;
+    }
+
+    size_t expandedBytes = expandedVertices * sizeof(Vertex);
+    size_t indexedBytes = uniqueVertices * sizeof(Vertex) + indexBytes;
+    if (logStats) {
+        std::cout << "Indexed '" << m_objFilePath << "': " << sourceParts << " -> " << ModelParts.size() << " parts, "
+            << expandedVertices << " -> " << uniqueVertices << " vertices, " << expandedBytes / 1024.0 << " KB -> " << indexedBytes / 1024.0 << " KB\n";
+        std::cout << "Vertex cache '" << m_objFilePath << "' (FIFO " << MeshOptimizer::FIFO_CACHE_SIZE << "): ACMR " << before.Acmr() << " -> " << after.Acmr()
+            << ", ATVR " << before.Atvr() << " -> " << after.Atvr() << "\n";
+        std::cout << "LODs '" << m_objFilePath << "': " << lodCount << " levels over " << ModelParts.size() << " parts, "
+            << before.triangles << " -> " << lodTriangles << " triangles at the coarsest levels\n";
+    }
+    return true;
+}
+
+void ObjLoader::BuildLodChain(ModelPart& part) {
+    part.lods.assign(1, { 0, part.indexCount, 0.0f });
+
+    float errorBudget = m_options.lodMaxError * glm::length(part.boundsMax - part.boundsMin);
+    float error = 0.0f;
+    std::vector<uint32_t> level = part.indices;
+
+    for (unsigned int i = 0; i < m_options.lodLevels; ++i) {
+        size_t targetIndexCount = static_cast<size_t>(level.size() / 3 * m_options.lodReduction) * 3;
+        float levelError;
+        std::vector<uint32_t> simplified = MeshSimplifier::Simplify(level, part.vertices, targetIndexCount, errorBudget - error, levelError);
+
+        // Levels locked by seams or the error budget are not worth another index range
+        if (simplified.empty() || simplified.size() * 10 > level.size() * 9) {
+            break;
+        }
+
+        if (m_options.optimizeMeshes) {
+            MeshOptimizer::OptimizeVertexCache(simplified, part.vertices.size());
+        }
+
+        error += levelError;
+        part.lods.push_back({ static_cast<unsigned int>(part.indices.size()), static_cast<unsigned int>(simplified.size()), error });
+        part.indices.insert(part.indices.end(), simplified.begin(), simplified.end());
+        level = std::move(simplified);
+    }
+
+    part.indexCount = static_cast<unsigned int>(part.indices.size());
+}
+
+void ObjLoader::BuildIndexedGeometry(const ObjData& data, const ObjCorner* corners, size_t cornerCount, ModelPart& part) {
+    // Open-addressing table from (v, vt, vn) triple to its index in part.vertices
+    constexpr uint32_t EMPTY = UINT32_MAX;
+    size_t tableSize = 16;
+    while (tableSize < cornerCount * 2) {
+        tableSize <<= 1;
+    }
+    std::vector<uint32_t> table(tableSize, EMPTY);
+    std::vector<ObjCorner> uniqueCorners;
+    uniqueCorners.reserve(cornerCount);
+    part.vertices.reserve(cornerCount);
+    part.indices.resize(cornerCount);
+
+    for (size_t i = 0; i < cornerCount; ++i) {
+        const ObjCorner& corner = corners[i];
+        uint64_t hash = (corner.position * 0x9E3779B97F4A7C15ull) ^ (corner.uv * 0xC2B2AE3D27D4EB4Full) ^ (corner.normal * 0x165667B19E3779F9ull);
+        size_t slot = static_cast<size_t>(hash ^ (hash >> 29)) & (tableSize - 1);
+
+        while (true) {
+            uint32_t index = table[slot];
+            if (index == EMPTY) {
+                index = static_cast<uint32_t>(part.vertices.size());
+                table[slot] = index;
+                uniqueCorners.push_back(corner);
+                part.vertices.push_back({ data.positions[corner.position], data.uvs[corner.uv], data.normals[corner.normal] });
+                part.indices[i] = index;
+                break;
             }
+            const ObjCorner& existing = uniqueCorners[index];
+            if (existing.position == corner.position && existing.uv == corner.uv && existing.normal == corner.normal) {
+                part.indices[i] = index;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+
+    part.vertices.shrink_to_fit();
+    part.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    part.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (const Vertex& vertex : part.vertices) {
+        part.boundsMin = glm::min(part.boundsMin, vertex.position);
+        part.boundsMax = glm::max(part.boundsMax, vertex.position);
+    }
+
+    double positionArea = 0.0;
+    double uvArea = 0.0;
+    for (size_t i = 0; i + 2 < part.indices.size(); i += 3) {
+        const Vertex& a = part.vertices[part.indices[i]];
+        const Vertex& b = part.vertices[part.indices[i + 1]];
+        const Vertex& c = part.vertices[part.indices[i + 2]];
+        positionArea += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        uvArea += std::abs((b.uv.x - a.uv.x) * (c.uv.y - a.uv.y) - (c.uv.x - a.uv.x) * (b.uv.y - a.uv.y));
+    }
+    part.uvDensity = UvDensity(positionArea, uvArea);
+
+    part.vertexCount = static_cast<unsigned int>(part.vertices.size());
+    part.indexCount = static_cast<unsigned int>(part.indices.size());
+    part.indexType = part.vertexCount <= UINT16_MAX + 1u ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+void ObjLoader::PackVertices() {
+    VertexFormat format = m_options.vertexFormat;
+    if (format == VertexFormat::Float32) {
+        return;
+    }
+
+    bool logStats = EngineLog::Verbose;
+    std::vector<VertexQuantizationError> errors(ModelParts.size());
+    ThreadPool::Shared().ParallelFor(ModelParts.size(), [&](size_t i) {
+        ModelPart& part = ModelParts[i];
+        part.vertexFormat = format;
+        part.dequantization = VertexFormats::Dequantization(format, part.boundsMin, part.boundsMax);
+        part.packedVertices = VertexFormats::Pack(format, part.vertices, part.dequantization);
+        if (logStats) {
+            errors[i] = VertexFormats::MeasureError(format, part.vertices, part.packedVertices, part.dequantization);
+        }
+        // Only the packed copy is uploaded or cached from here on
+        part.vertices = std::vector<Vertex>();
+    });
+    if (!logStats) {
+        return;
+    }
+
+    // Report the worst case over the model, with positions relative to the size of the whole model
+    VertexQuantizationError worst;
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    size_t vertexCount = 0;
+    for (size_t i = 0; i < ModelParts.size(); ++i) {
+        const ModelPart& part = ModelParts[i];
+        worst.maxPosition = std::max(worst.maxPosition, errors[i].maxPosition);
+        worst.meanPosition += errors[i].meanPosition * part.vertexCount;
+        worst.maxNormalDegrees = std::max(worst.maxNormalDegrees, errors[i].maxNormalDegrees);
+        worst.maxUv = std::max(worst.maxUv, errors[i].maxUv);
+        boundsMin = glm::min(boundsMin, part.boundsMin);
+        boundsMax = glm::max(boundsMax, part.boundsMax);
+        vertexCount += part.vertexCount;
+    }
+    if (vertexCount == 0) {
+        return;
+    }
+    worst.meanPosition /= static_cast<double>(vertexCount);
+    float diagonal = glm::length(boundsMax - boundsMin);
+
+    std::cout << "Packed '" << m_objFilePath << "': " << sizeof(Vertex) << " -> " << VertexFormats::Stride(format) << " bytes per vertex, "
+        << vertexCount * sizeof(Vertex) / 1024.0 << " KB -> " << vertexCount * VertexFormats::Stride(format) / 1024.0 << " KB; max error position "
+        << worst.maxPosition << " (" << (diagonal > 0.0f ? worst.maxPosition / diagonal * 100.0f : 0.0f) << "% of diagonal, mean "
+        << worst.meanPosition << "), normal " << worst.maxNormalDegrees << " deg, uv " << worst.maxUv << "\n";
+}
+
+void ObjLoader::PackIndices() {
+    m_shortIndices.resize(ModelParts.size());
+
+    for (size_t i = 0; i < ModelParts.size(); ++i) {
+        const ModelPart& part = ModelParts[i];
+        if (part.indexType == GL_UNSIGNED_SHORT) {
+            m_shortIndices[i].assign(part.indices.begin(), part.indices.end());
         }
-        else if (strncmp(line, "f ", 2) == 0) {
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-            int matches = sscanf_s(line + 2, "%d/%d/%d %d/%d/%d %d/%d/%d",
-                &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-                &vertexIndex[1], &uvIndex[1], &normalIndex[1],
-                &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-            if (matches != 9) {
-                std::cerr << "File can't be read by our simple parser. Try exporting with other options.\n";
-                return;
+    }
+}
+
+bool ObjLoader::Upload(std::chrono::steady_clock::time_point deadline) {
+    bool unbounded = deadline == std::chrono::steady_clock::time_point::max();
+
+    while (!m_isUploaded) {
+        if (m_uploadedTextures < m_pendingTextures.size()) {
+            const PendingTexture& pending = m_pendingTextures[m_uploadedTextures++];
+            Material& material = MaterialData[pending.materialName];
+            if (m_options.textureArrays) {
+                TextureLayer layer = TextureCache::Shared().AcquireLayer(pending.imagePath);
+                material.textureID = layer.texture;
+                material.textureLayer = layer.IsValid() ? static_cast<int>(layer.layer) : -1;
             }
-            if (currentModelPart == nullptr) {
-                ModelParts.emplace_back();
-                currentModelPart = &ModelParts.back();
-                currentModelPart->materialName = currentMaterialName;
+            else {
+                material.textureID = TextureCache::Shared().Acquire(pending.imagePath);
             }
-            Face face;
-            for (int i = 0; i < 3; ++i) {
-                face.vertices[i] = temp_vertices[vertexIndex[i] - 1];
-                face.uvs[i] = temp_uvs[uvIndex[i] - 1];
-                face.normals[i] = temp_normals[normalIndex[i] - 1];
+        }
+        else if (m_uploadedParts < ModelParts.size()) {
+            CreatePartBuffers(m_uploadedParts++, unbounded);
+        }
+        else if (m_uploadedBuffers < m_pendingBuffers.size()) {
+            // Large buffers are filled in slices so one huge part cannot blow the frame budget
+            PendingBufferUpload& pending = m_pendingBuffers[m_uploadedBuffers];
+            size_t slice = std::min(UPLOAD_SLICE_BYTES, pending.size - pending.offset);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pending.buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, pending.offset, slice, pending.data + pending.offset);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            pending.offset += slice;
+            if (pending.offset == pending.size) {
+                m_uploadedBuffers++;
             }
-            currentModelPart->faces.push_back(face);
-            currentModelPart->vertexCount += 3;
         }
-        else if (strncmp(line, "usemtl ", 7) == 0) {
-            currentMaterialName = line + 7;
-            // Remove trailing newline if present
-            currentMaterialName.erase(std::remove(currentMaterialName.begin(), currentMaterialName.end(), '\n'), currentMaterialName.end());
+        else {
+            ReleaseImportData();
+            m_isUploaded = true;
+        }
 
-            // Create new ModelPart for the new material
-            ModelParts.emplace_back();
-            currentModelPart = &ModelParts.back();
-            currentModelPart->materialName = currentMaterialName;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            break;
         }
     }
 
-    return;
+    return m_isUploaded;
 }
 
-void ObjLoader::LoadTexture(int& width, int& height, int& nrChannels, unsigned int& texture, const char* file, bool hasAlpha)
-{
-    unsigned char* data = stbi_load(file, &width, &height, &nrChannels, 0);
+void ObjLoader::InternMaterials() {
+    if (m_materialsInterned) {
+        return;
+    }
 
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // Parts look their material up by name once here instead of on every draw
+    std::string library = Vfs::Normalize(m_mtlFilePath);
+    std::unordered_map<std::string, MaterialId> idsByName;
+    for (const auto& [name, material] : MaterialData) {
+        MaterialId id = MaterialTable::Shared().Intern(library, name, material);
+        MaterialIds.push_back(id);
+        idsByName[name] = id;
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    for (ModelPart& part : ModelParts) {
+        auto id = idsByName.find(part.materialName);
+        part.materialId = id == idsByName.end() ? INVALID_MATERIAL : id->second;
+    }
+    MaterialData = std::unordered_map<std::string, Material>();
+    m_materialsInterned = true;
+}
 
-    if (data)
-    {
-        if (hasAlpha)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        else
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+void ObjLoader::DiscardMaterials() {
+    for (const auto& [name, material] : MaterialData) {
+        if (material.textureID == 0) {
+            continue;
+        }
+        if (material.textureLayer >= 0) {
+            TextureCache::Shared().Release(TextureLayer{ material.textureID, static_cast<uint32_t>(material.textureLayer) });
+        }
+        else {
+            TextureCache::Shared().Release(material.textureID);
+        }
+    }
+    MaterialData = std::unordered_map<std::string, Material>();
+}
+
+void ObjLoader::ReleaseImportData() {
+    m_pendingTextures = std::vector<PendingTexture>();
+    m_pendingBuffers = std::vector<PendingBufferUpload>();
+    m_shortIndices = std::vector<std::vector<uint16_t>>();
+    m_meshCache.reset();
+
+    // The GPU owns the geometry now; keep only the counts
+    for (ModelPart& part : ModelParts) {
+        part.vertices = std::vector<Vertex>();
+        part.indices = std::vector<uint32_t>();
+        part.packedVertices = std::vector<unsigned char>();
+    }
+}
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+void ObjLoader::CreatePartBuffers(size_t partIndex, bool uploadNow) {
+    const ModelPart& part = ModelParts[partIndex];
+    const void* vertexData;
+    const void* indexData;
+    size_t vertexBytes;
+    size_t indexBytes;
+
+    if (m_meshCache) {
+        vertexData = m_meshCache->VertexData(partIndex);
+        vertexBytes = m_meshCache->VertexBytes(partIndex);
+        indexData = m_meshCache->IndexData(partIndex);
+        indexBytes = m_meshCache->IndexBytes(partIndex);
     }
-    else
-    {
-        std::cout << "Failed to load texture" << std::endl;
+    else {
+        vertexData = part.VertexData();
+        vertexBytes = part.VertexBytes();
+        // Indices are narrowed to 16 bits when the part is small enough
+        if (part.indexType == GL_UNSIGNED_SHORT) {
+            indexData = m_shortIndices[partIndex].data();
+            indexBytes = m_shortIndices[partIndex].size() * sizeof(uint16_t);
+        }
+        else {
+            indexData = part.indices.data();
+            indexBytes = part.indices.size() * sizeof(uint32_t);
+        }
     }
 
-    stbi_image_free(data);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLuint VAO, VBO, EBO;
+    UploadModelPart(part.vertexFormat, uploadNow ? vertexData : nullptr, vertexBytes, uploadNow ? indexData : nullptr, indexBytes, VAO, VBO, EBO);
+    VAOS.push_back(VAO);
+    VBOS.push_back(VBO);
+    EBOS.push_back(EBO);
+
+    if (!uploadNow) {
+        m_pendingBuffers.push_back({ VBO, static_cast<const unsigned char*>(vertexData), vertexBytes, 0 });
+        m_pendingBuffers.push_back({ EBO, static_cast<const unsigned char*>(indexData), indexBytes, 0 });
+    }
 }
 
-void ObjLoader::SetupModelPartBuffers(const ModelPart& part, GLuint& VAO, GLuint& VBO) {
+void ObjLoader::UploadModelPart(VertexFormat vertexFormat, const void* vertexData, size_t vertexBytes, const void* indexData, size_t indexBytes, GLuint& VAO, GLuint& VBO, GLuint& EBO) {
     // Generate buffers
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
     glGenVertexArrays(1, &VAO);
 
     glBindVertexArray(VAO);
 
-    // Prepare data for VBO
-    std::vector<float> vertexData;
-
-    for (const auto& face : part.faces) {
-        for (int i = 0; i < 3; ++i) {
-            const glm::vec3& vertex = face.vertices[i];
-            const glm::vec2& uv = face.uvs[i];
-            const glm::vec3& normal = face.normals[i];
-
-            vertexData.insert(vertexData.end(), { vertex.x, vertex.y, vertex.z });
-            vertexData.insert(vertexData.end(), { uv.x, uv.y });
-            vertexData.insert(vertexData.end(), { normal.x, normal.y, normal.z });
-        }
-    }
-
-    // Upload vertex data to VBO
+    // Upload vertex data to VBO and indices to EBO (storage only when the data is streamed in later)
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
-
-    // Set up vertex attribute pointers
-    // Assuming layout is as follows: 
-    // position (3 floats), uv (2 floats), normal (3 floats)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); // Position
-    glEnableVertexAttribArray(0);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); // UV
-    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float))); // Normal
-    glEnableVertexAttribArray(2);
+    // Set up vertex attribute pointers
+    VertexFormats::SetupAttributes(vertexFormat);
 
-    // Unbind VAO
+    // Unbind VAO (the element buffer binding is part of the VAO state, so it stays attached)
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
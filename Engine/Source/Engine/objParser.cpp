@@ -0,0 +1,393 @@
+#include "objParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "threadPool.h"
+
+namespace {
+
+    enum class LineType {
+        Position,
+        Uv,
+        Normal,
+        Face,
+        UseMaterial,
+        Other
+    };
+
+    inline bool IsBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* SkipBlanks(const char* p, const char* end)
+    {
+        while (p < end && IsBlank(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    inline const char* FindLineEnd(const char* p, const char* end)
+    {
+        const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        return newline ? newline : end;
+    }
+
+    // Identifies the keyword at the start of a line and moves `p` past it
+    inline LineType Classify(const char*& p, const char* lineEnd)
+    {
+        p = SkipBlanks(p, lineEnd);
+        size_t length = lineEnd - p;
+
+        if (length >= 2 && p[0] == 'v') {
+            if (IsBlank(p[1])) {
+                p += 2;
+                return LineType::Position;
+            }
+            if (length >= 3 && IsBlank(p[2])) {
+                if (p[1] == 't') {
+                    p += 3;
+                    return LineType::Uv;
+                }
+                if (p[1] == 'n') {
+                    p += 3;
+                    return LineType::Normal;
+                }
+            }
+        }
+        else if (length >= 2 && p[0] == 'f' && IsBlank(p[1])) {
+            p += 2;
+            return LineType::Face;
+        }
+        else if (length >= 7 && memcmp(p, "usemtl", 6) == 0 && IsBlank(p[6])) {
+            p += 7;
+            return LineType::UseMaterial;
+        }
+
+        return LineType::Other;
+    }
+
+    inline bool ParseFloat(const char*& p, const char* end, float& value)
+    {
+        p = SkipBlanks(p, end);
+        if (p < end && *p == '+') {
+            ++p;
+        }
+
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        if (ec == std::errc::result_out_of_range) {
+            // from_chars leaves the value untouched on under/overflow; match strtof's rounding instead
+            std::string token(p, ptr);
+            value = std::strtof(token.c_str(), nullptr);
+        }
+        else if (ec != std::errc()) {
+            return false;
+        }
+
+        p = ptr;
+        return true;
+    }
+
+    inline bool ParseIndex(const char*& p, const char* end, long long& value)
+    {
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc() || value == 0) {
+            return false;
+        }
+
+        p = ptr;
+        return true;
+    }
+
+    // OBJ indices are 1-based; negative indices are relative to the end of the pool so far
+    inline bool ResolveIndex(long long index, size_t poolSize, uint32_t& resolved)
+    {
+        long long zeroBased = index > 0 ? index - 1 : static_cast<long long>(poolSize) + index;
+        if (zeroBased < 0 || zeroBased > static_cast<long long>(UINT32_MAX)) {
+            return false;
+        }
+
+        resolved = static_cast<uint32_t>(zeroBased);
+        return true;
+    }
+
+    // Global pool sizes at the current line; also the write offsets into the presized ObjData arrays
+    struct ParseCursor {
+        size_t position = 0;
+        size_t uv = 0;
+        size_t normal = 0;
+        size_t face = 0;
+    };
+
+    inline bool ParseCorner(const char*& p, const char* end, const ParseCursor& cursor, ObjCorner& corner)
+    {
+        long long position, uv, normal;
+
+        p = SkipBlanks(p, end);
+        if (!ParseIndex(p, end, position) || p >= end || *p++ != '/') return false;
+        if (!ParseIndex(p, end, uv) || p >= end || *p++ != '/') return false;
+        if (!ParseIndex(p, end, normal)) return false;
+
+        return ResolveIndex(position, cursor.position, corner.position)
+            && ResolveIndex(uv, cursor.uv, corner.uv)
+            && ResolveIndex(normal, cursor.normal, corner.normal);
+    }
+
+    inline bool IsLineDone(const char* p, const char* lineEnd)
+    {
+        p = SkipBlanks(p, lineEnd);
+        return p == lineEnd || *p == '#';
+    }
+
+    inline std::string TrimmedName(const char* p, const char* lineEnd)
+    {
+        p = SkipBlanks(p, lineEnd);
+        while (lineEnd > p && IsBlank(lineEnd[-1])) {
+            --lineEnd;
+        }
+        return std::string(p, lineEnd);
+    }
+
+    struct ChunkResult {
+        ObjCounts counts;
+        ParseCursor start;
+        size_t firstLine = 0;
+        std::vector<ObjPartRange> parts;
+        bool startsWithoutMaterial = false;
+        bool storeFaces = true;
+        std::string error;
+    };
+
+    // Parses one line-aligned range into the presized arrays of `data`, starting at the offsets in `chunk.start`
+    void ParseChunk(const char* begin, const char* end, ObjData& data, ChunkResult& chunk)
+    {
+        ParseCursor cursor = chunk.start;
+        size_t lineNumber = chunk.firstLine;
+
+        for (const char* p = begin; p < end; ) {
+            const char* lineEnd = FindLineEnd(p, end);
+            lineNumber++;
+
+            switch (Classify(p, lineEnd)) {
+            case LineType::Position: {
+                glm::vec3& vertex = data.positions[cursor.position++];
+                if (!ParseFloat(p, lineEnd, vertex.x) || !ParseFloat(p, lineEnd, vertex.y) || !ParseFloat(p, lineEnd, vertex.z)) {
+                    chunk.error = "line " + std::to_string(lineNumber) + ": expected 3 position coordinates";
+                    return;
+                }
+                break;
+            }
+            case LineType::Uv: {
+                glm::vec2& uv = data.uvs[cursor.uv++];
+                if (!ParseFloat(p, lineEnd, uv.x)) {
+                    chunk.error = "line " + std::to_string(lineNumber) + ": expected a texture coordinate";
+                    return;
+                }
+                // V is optional in OBJ and defaults to 0
+                if (!IsLineDone(p, lineEnd) && !ParseFloat(p, lineEnd, uv.y)) {
+                    chunk.error = "line " + std::to_string(lineNumber) + ": malformed texture coordinate";
+                    return;
+                }
+                // Invert V coordinate to conform with OpenGL standards
+                uv.y = 1.0f - uv.y;
+                break;
+            }
+            case LineType::Normal: {
+                glm::vec3& normal = data.normals[cursor.normal++];
+                if (!ParseFloat(p, lineEnd, normal.x) || !ParseFloat(p, lineEnd, normal.y) || !ParseFloat(p, lineEnd, normal.z)) {
+                    chunk.error = "line " + std::to_string(lineNumber) + ": expected 3 normal components";
+                    return;
+                }
+                break;
+            }
+            case LineType::Face: {
+                ObjCorner scratch[3];
+                ObjCorner* corners = chunk.storeFaces ? data.corners.data() + cursor.face * 3 : scratch;
+                if (!ParseCorner(p, lineEnd, cursor, corners[0]) || !ParseCorner(p, lineEnd, cursor, corners[1])
+                    || !ParseCorner(p, lineEnd, cursor, corners[2]) || !IsLineDone(p, lineEnd)) {
+                    chunk.error = "line " + std::to_string(lineNumber) + ": expected a triangle of v/vt/vn indices";
+                    return;
+                }
+
+                if (chunk.parts.empty()) {
+                    chunk.startsWithoutMaterial = true;
+                    chunk.parts.emplace_back().firstFace = cursor.face;
+                }
+                chunk.parts.back().faceCount++;
+                cursor.face++;
+                break;
+            }
+            case LineType::UseMaterial: {
+                ObjPartRange& part = chunk.parts.emplace_back();
+                part.materialName = TrimmedName(p, lineEnd);
+                part.firstFace = cursor.face;
+                break;
+            }
+            case LineType::Other:
+                break;
+            }
+
+            p = lineEnd + 1;
+        }
+    }
+
+    // Splits [begin, end) into at most `count` ranges that all start at the beginning of a line
+    std::vector<const char*> SplitAtLines(const char* begin, const char* end, size_t count)
+    {
+        std::vector<const char*> bounds{ begin };
+        size_t size = end - begin;
+
+        for (size_t i = 1; i < count; ++i) {
+            const char* split = begin + size * i / count;
+            if (split <= bounds.back()) {
+                continue;
+            }
+            split = FindLineEnd(split, end);
+            split = split < end ? split + 1 : end;
+            if (split > bounds.back() && split < end) {
+                bounds.push_back(split);
+            }
+        }
+
+        bounds.push_back(end);
+        return bounds;
+    }
+
+}
+
+ObjCounts ObjParser::Count(const char* begin, const char* end)
+{
+    ObjCounts counts;
+
+    for (const char* p = begin; p < end; ) {
+        const char* lineEnd = FindLineEnd(p, end);
+        counts.lines++;
+
+        switch (Classify(p, lineEnd)) {
+        case LineType::Position: counts.positions++; break;
+        case LineType::Uv: counts.uvs++; break;
+        case LineType::Normal: counts.normals++; break;
+        case LineType::Face: counts.faces++; break;
+        case LineType::UseMaterial: counts.materials++; break;
+        case LineType::Other: break;
+        }
+
+        p = lineEnd + 1;
+    }
+
+    return counts;
+}
+
+bool ObjParser::Parse(const char* begin, const char* end, ObjData& data, std::string& error, size_t chunkCount)
+{
+    return Parse(begin, end, data, error, chunkCount, true);
+}
+
+bool ObjParser::ParseAttributes(const char* begin, const char* end, ObjData& data, std::string& error, size_t chunkCount)
+{
+    return Parse(begin, end, data, error, chunkCount, false);
+}
+
+bool ObjParser::ForEachFace(const char* begin, const char* end, const std::function<bool(size_t, const ObjCorner*)>& onFace, std::string& error)
+{
+    ParseCursor cursor;
+    size_t lineNumber = 0;
+    // Same numbering as the stitched ranges of Parse: leading faces without a material form range 0
+    size_t part = SIZE_MAX;
+
+    for (const char* p = begin; p < end; ) {
+        const char* lineEnd = FindLineEnd(p, end);
+        lineNumber++;
+
+        switch (Classify(p, lineEnd)) {
+        case LineType::Position: cursor.position++; break;
+        case LineType::Uv: cursor.uv++; break;
+        case LineType::Normal: cursor.normal++; break;
+        case LineType::UseMaterial: part = part == SIZE_MAX ? 0 : part + 1; break;
+        case LineType::Face: {
+            ObjCorner corners[3];
+            if (!ParseCorner(p, lineEnd, cursor, corners[0]) || !ParseCorner(p, lineEnd, cursor, corners[1])
+                || !ParseCorner(p, lineEnd, cursor, corners[2]) || !IsLineDone(p, lineEnd)) {
+                error = "line " + std::to_string(lineNumber) + ": expected a triangle of v/vt/vn indices";
+                return false;
+            }
+            if (part == SIZE_MAX) {
+                part = 0;
+            }
+            if (!onFace(part, corners)) {
+                return false;
+            }
+            cursor.face++;
+            break;
+        }
+        case LineType::Other:
+            break;
+        }
+
+        p = lineEnd + 1;
+    }
+
+    return true;
+}
+
+bool ObjParser::Parse(const char* begin, const char* end, ObjData& data, std::string& error, size_t chunkCount, bool storeFaces)
+{
+    ThreadPool& pool = ThreadPool::Shared();
+
+    if (chunkCount == 0) {
+        chunkCount = pool.ThreadCount() + 1;
+    }
+    chunkCount = std::clamp<size_t>((end - begin) / MIN_CHUNK_BYTES, 1, chunkCount);
+
+    std::vector<const char*> bounds = SplitAtLines(begin, end, chunkCount);
+    std::vector<ChunkResult> chunks(bounds.size() - 1);
+
+    // Pass 1: count every chunk so each one knows where its lines land in the global arrays
+    pool.ParallelFor(chunks.size(), [&](size_t i) {
+        chunks[i].counts = Count(bounds[i], bounds[i + 1]);
+    });
+
+    ObjCounts total;
+    for (ChunkResult& chunk : chunks) {
+        chunk.start = { total.positions, total.uvs, total.normals, total.faces };
+        chunk.firstLine = total.lines;
+        total.positions += chunk.counts.positions;
+        total.uvs += chunk.counts.uvs;
+        total.normals += chunk.counts.normals;
+        total.faces += chunk.counts.faces;
+        total.lines += chunk.counts.lines;
+    }
+
+    data = ObjData();
+    data.positions.resize(total.positions);
+    data.uvs.resize(total.uvs);
+    data.normals.resize(total.normals);
+    data.corners.resize(storeFaces ? total.faces * 3 : 0);
+
+    // Pass 2: parse every chunk straight into its slice of the arrays
+    pool.ParallelFor(chunks.size(), [&](size_t i) {
+        chunks[i].storeFaces = storeFaces;
+        ParseChunk(bounds[i], bounds[i + 1], data, chunks[i]);
+    });
+
+    // Stitch the material ranges; faces before a chunk's first `usemtl` continue the previous range
+    for (ChunkResult& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            error = chunk.error;
+            return false;
+        }
+
+        auto part = chunk.parts.begin();
+        if (chunk.startsWithoutMaterial && !data.parts.empty()) {
+            data.parts.back().faceCount += part->faceCount;
+            ++part;
+        }
+        data.parts.insert(data.parts.end(), std::make_move_iterator(part), std::make_move_iterator(chunk.parts.end()));
+    }
+
+    return true;
+}
@@ -0,0 +1,204 @@
+#include "pakArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "hash.h"
+#include "lz4Block.h"
+#include "threadPool.h"
+
+namespace {
+
+    constexpr char MAGIC[4] = { 'G', 'P', 'A', 'K' };
+    constexpr uint64_t COMPRESSED_ALIGNMENT = 16;
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    void WritePadding(std::ofstream& file, uint64_t& offset, uint64_t alignment)
+    {
+        static const char zeros[PakArchive::ALIGNMENT] = {};
+        uint64_t aligned = AlignUp(offset, alignment);
+        file.write(zeros, static_cast<std::streamsize>(aligned - offset));
+        offset = aligned;
+    }
+
+}
+
+bool PakArchive::Open(const std::string& path)
+{
+    m_header = nullptr;
+    m_entries = nullptr;
+
+    if (!m_file.Open(path) || m_file.Size() < sizeof(PakHeader)) {
+        return false;
+    }
+
+    const PakHeader* header = reinterpret_cast<const PakHeader*>(m_file.Data());
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+        || header->tocOffset % alignof(PakEntry) != 0 || header->tocOffset > m_file.Size()
+        || static_cast<uint64_t>(header->entryCount) * sizeof(PakEntry) > m_file.Size() - header->tocOffset
+        || header->namesOffset > m_file.Size() || header->namesSize > m_file.Size() - header->namesOffset) {
+        return false;
+    }
+
+    const PakEntry* entries = reinterpret_cast<const PakEntry*>(m_file.Data() + header->tocOffset);
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+        const PakEntry& entry = entries[i];
+        if (entry.offset > m_file.Size() || entry.size > m_file.Size() - entry.offset
+            || static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > header->namesSize
+            || entry.compression > static_cast<uint32_t>(PakCompression::Lz4)
+            || (entry.compression == static_cast<uint32_t>(PakCompression::None) && entry.size != entry.originalSize)) {
+            return false;
+        }
+    }
+
+    m_header = header;
+    m_entries = entries;
+    return true;
+}
+
+const PakEntry* PakArchive::Find(std::string_view name) const
+{
+    if (!m_header) {
+        return nullptr;
+    }
+
+    uint64_t hash = Hash::Fnv1a64(name);
+    const PakEntry* end = m_entries + m_header->entryCount;
+    const PakEntry* entry = std::lower_bound(m_entries, end, hash, [](const PakEntry& e, uint64_t h) { return e.pathHash < h; });
+    for (; entry != end && entry->pathHash == hash; ++entry) {
+        if (Name(*entry) == name) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+std::string_view PakArchive::Name(const PakEntry& entry) const
+{
+    return std::string_view(m_file.Data() + m_header->namesOffset + entry.nameOffset, entry.nameLength);
+}
+
+void PakWriter::Add(const std::string& name, const std::string& sourcePath, bool allowCompression)
+{
+    m_pending.push_back({ name, sourcePath, allowCompression });
+}
+
+bool PakWriter::Write(const std::string& path, PakWriteReport& report) const
+{
+    report = PakWriteReport();
+
+    std::vector<PendingEntry> pending = m_pending;
+    std::sort(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) {
+        uint64_t hashA = Hash::Fnv1a64(a.name);
+        uint64_t hashB = Hash::Fnv1a64(b.name);
+        return hashA != hashB ? hashA < hashB : a.name < b.name;
+    });
+    pending.erase(std::unique(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) { return a.name == b.name; }), pending.end());
+
+    // Hash and compress every entry up front; the sources stay mapped until they are written
+    std::vector<MappedFile> sources(pending.size());
+    std::vector<std::vector<char>> compressed(pending.size());
+    std::vector<PakEntry> entries(pending.size());
+    std::vector<char> opened(pending.size(), 0);
+    ThreadPool::Shared().ParallelFor(pending.size(), [&](size_t i) {
+        if (!sources[i].Open(pending[i].sourcePath)) {
+            return;
+        }
+        opened[i] = 1;
+
+        PakEntry& entry = entries[i];
+        entry.pathHash = Hash::Fnv1a64(pending[i].name);
+        entry.originalSize = sources[i].Size();
+        entry.size = entry.originalSize;
+        entry.contentHash = Hash::Xxh64(sources[i].Data(), sources[i].Size());
+        entry.compression = static_cast<uint32_t>(PakCompression::None);
+
+        if (!pending[i].allowCompression || sources[i].Size() == 0) {
+            return;
+        }
+        std::vector<char>& buffer = compressed[i];
+        buffer.resize(Lz4::CompressBound(sources[i].Size()));
+        size_t size = Lz4::Compress(sources[i].Data(), sources[i].Size(), buffer.data(), buffer.size());
+        if (size == 0 || size > sources[i].Size() - sources[i].Size() / 8) {
+            buffer.clear();
+            buffer.shrink_to_fit();
+            return;
+        }
+        buffer.resize(size);
+        entry.size = size;
+        entry.compression = static_cast<uint32_t>(PakCompression::Lz4);
+    });
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (!opened[i]) {
+            std::cerr << "Failed to open '" << pending[i].sourcePath << "' for the archive" << std::endl;
+            return false;
+        }
+    }
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        // Header first, rewritten once the table offsets are known
+        PakHeader header = {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = PakArchive::VERSION;
+        header.entryCount = static_cast<uint32_t>(pending.size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t offset = sizeof(header);
+
+        std::string names;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            PakEntry& entry = entries[i];
+            bool isCompressed = entry.compression != static_cast<uint32_t>(PakCompression::None);
+            WritePadding(file, offset, isCompressed ? COMPRESSED_ALIGNMENT : PakArchive::ALIGNMENT);
+            entry.offset = offset;
+            // An empty source opens without a mapping (Data() is null); its entry is just a name
+            if (entry.size > 0) {
+                file.write(isCompressed ? compressed[i].data() : sources[i].Data(), static_cast<std::streamsize>(entry.size));
+            }
+            offset += entry.size;
+
+            entry.nameOffset = static_cast<uint32_t>(names.size());
+            entry.nameLength = static_cast<uint32_t>(pending[i].name.size());
+            names += pending[i].name;
+
+            report.entries++;
+            report.compressedEntries += isCompressed ? 1 : 0;
+            report.originalBytes += entry.originalSize;
+        }
+
+        WritePadding(file, offset, alignof(PakEntry));
+        header.tocOffset = offset;
+        file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PakEntry)));
+        offset += entries.size() * sizeof(PakEntry);
+
+        header.namesOffset = offset;
+        header.namesSize = names.size();
+        file.write(names.data(), static_cast<std::streamsize>(names.size()));
+        offset += names.size();
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        report.archiveBytes = offset;
+
+        if (!file.good()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
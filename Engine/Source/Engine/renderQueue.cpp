@@ -0,0 +1,270 @@
+#include "renderQueue.h"
+
+#include <algorithm>
+
+#include "materialTable.h"
+
+namespace {
+
+    // Below this many draws std::sort beats the fixed cost of eight histograms
+    constexpr size_t RADIX_SORT_THRESHOLD = 64;
+
+    constexpr uint64_t Field(uint64_t value, uint32_t bits, uint32_t shift)
+    {
+        return (value & ((1ull << bits) - 1)) << shift;
+    }
+
+}
+
+RenderQueue::~RenderQueue()
+{
+    if (m_instanceBuffer != 0) {
+        glDeleteBuffers(1, &m_instanceBuffer);
+    }
+}
+
+void RenderQueue::Begin(const glm::mat4& view, float farPlane)
+{
+    m_view = view;
+    m_farPlane = farPlane;
+    m_packets.clear();
+    m_entries.clear();
+    m_transforms.clear();
+    m_depthRows.clear();
+}
+
+uint32_t RenderQueue::AddTransform(const glm::mat4& model)
+{
+    glm::mat4 viewModel = m_view * model;
+    m_transforms.push_back(model);
+    m_depthRows.push_back(glm::vec4(viewModel[0][2], viewModel[1][2], viewModel[2][2], viewModel[3][2]));
+    return static_cast<uint32_t>(m_transforms.size() - 1);
+}
+
+void RenderQueue::Add(RenderPass pass, uint32_t layer, GLuint program, GLuint instancedProgram, const ModelPart& part, GLuint vao, uint32_t transform, unsigned int lodLevel)
+{
+    DrawPacket packet;
+    packet.part = &part;
+    packet.program = program;
+    packet.instancedProgram = instancedProgram;
+    packet.vao = vao;
+    packet.texture = 0;
+    packet.layer = -1;
+    packet.transform = transform;
+    packet.firstIndex = 0;
+    packet.indexCount = part.indexCount;
+    if (part.materialId != INVALID_MATERIAL) {
+        const MaterialTable& materials = MaterialTable::Shared();
+        packet.texture = materials.Texture(part.materialId);
+        packet.layer = materials.Layer(part.materialId);
+    }
+    // Every level lives in the same element buffer; draw only the selected range
+    if (lodLevel < part.lods.size()) {
+        packet.firstIndex = part.lods[lodLevel].firstIndex;
+        packet.indexCount = part.lods[lodLevel].indexCount;
+    }
+
+    // View space looks down -z
+    glm::vec3 center = (part.boundsMin + part.boundsMax) * 0.5f;
+    float depth = -glm::dot(m_depthRows[transform], glm::vec4(center, 1.0f));
+
+    m_entries.push_back({ MakeKey(pass, layer, program, packet.texture, part.materialId, vao, QuantizeDepth(depth)), static_cast<uint32_t>(m_packets.size()) });
+    m_packets.push_back(packet);
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, uint32_t layer, GLuint program, GLuint texture, MaterialId material, GLuint vao, uint32_t depth)
+{
+    uint64_t key = Field(static_cast<uint64_t>(pass), 2, 62) | Field(layer, 4, 58);
+    if (pass == RenderPass::Transparent) {
+        uint32_t farToNear = (1u << DEPTH_BITS) - 1 - depth;
+        return key | Field(farToNear, DEPTH_BITS, 44) | Field(program, 8, 36) | Field(texture, 12, 24) | Field(material, 12, 12) | Field(vao, 12, 0);
+    }
+    return key | Field(program, 8, 50) | Field(texture, 12, 38) | Field(material, 12, 26) | Field(vao, 12, 14) | Field(depth, DEPTH_BITS, 0);
+}
+
+uint32_t RenderQueue::QuantizeDepth(float depth) const
+{
+    float normalized = std::clamp(depth / m_farPlane, 0.0f, 1.0f);
+    return static_cast<uint32_t>(normalized * ((1u << DEPTH_BITS) - 1));
+}
+
+void RenderQueue::Sort()
+{
+    if (m_entries.size() < RADIX_SORT_THRESHOLD) {
+        std::sort(m_entries.begin(), m_entries.end(), [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+        return;
+    }
+    RadixSort();
+}
+
+void RenderQueue::RadixSort()
+{
+    // Least significant byte first; every pass is stable, so earlier bytes keep their order within equal later ones
+    size_t count = m_entries.size();
+    m_scratch.resize(count);
+
+    size_t histograms[8][256] = {};
+    for (const SortEntry& entry : m_entries) {
+        for (uint32_t byte = 0; byte < 8; ++byte) {
+            histograms[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+        }
+    }
+
+    SortEntry* source = m_entries.data();
+    SortEntry* destination = m_scratch.data();
+    for (uint32_t byte = 0; byte < 8; ++byte) {
+        size_t* histogram = histograms[byte];
+        uint32_t shift = byte * 8;
+        // A byte every key shares (the unused high fields, usually) leaves the order as it is
+        if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; ++bucket) {
+            size_t size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != m_entries.data()) {
+        m_entries.swap(m_scratch);
+    }
+}
+
+RenderQueueStats RenderQueue::Submit(UniformBuffers& uniforms)
+{
+    BuildBatches();
+    UploadInstances();
+
+    RenderQueueStats stats;
+    BoundState bound;
+    for (const Batch& batch : m_batches) {
+        const DrawPacket& first = m_packets[m_entries[batch.first].packet];
+        const ModelPart& part = *first.part;
+        size_t indexSize = part.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        for (size_t i = 0; i < (batch.instanced ? 1 : batch.count); ++i) {
+            const DrawPacket& packet = m_packets[m_entries[batch.first + i].packet];
+            Bind(packet, batch.instanced ? packet.instancedProgram : packet.program, bound, stats);
+
+            DrawUniforms draw;
+            draw.model = m_transforms[packet.transform];
+            draw.positionScale = glm::vec4(part.dequantization.scale, 0.0f);
+            draw.positionOffset = glm::vec4(part.dequantization.offset, 0.0f);
+            draw.material = glm::ivec4(packet.layer, 0, 0, 0);
+            uniforms.PushDraw(draw);
+
+            if (batch.instanced) {
+                // Points the VAO's instance attributes at this batch's matrices; plain programs never read them
+                glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+                size_t offset = batch.firstInstance * sizeof(glm::mat4);
+                for (GLuint column = 0; column < 4; ++column) {
+                    GLuint location = INSTANCE_LOCATION + column;
+                    glEnableVertexAttribArray(location);
+                    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+                    glVertexAttribDivisor(location, 1);
+                }
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+                glDrawElementsInstanced(GL_TRIANGLES, packet.indexCount, part.indexType, (void*)(packet.firstIndex * indexSize), static_cast<GLsizei>(batch.count));
+                stats.instancedDraws++;
+                stats.instances += batch.count;
+            }
+            else {
+                glDrawElements(GL_TRIANGLES, packet.indexCount, part.indexType, (void*)(packet.firstIndex * indexSize));
+            }
+            stats.draws++;
+        }
+        stats.triangles += first.indexCount / 3 * batch.count;
+    }
+
+    glBindVertexArray(0);
+    if (bound.texture != 0) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    if (bound.textureArray != 0) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    return stats;
+}
+
+void RenderQueue::BuildBatches()
+{
+    m_batches.clear();
+    m_instances.clear();
+
+    for (size_t first = 0; first < m_entries.size();) {
+        const DrawPacket& packet = m_packets[m_entries[first].packet];
+        size_t end = first + 1;
+        while (end < m_entries.size() && SameDraw(packet, m_packets[m_entries[end].packet])) {
+            end++;
+        }
+
+        Batch batch = { first, end - first, false, 0 };
+        if (batch.count >= MIN_INSTANCES && packet.instancedProgram != 0) {
+            batch.instanced = true;
+            batch.firstInstance = m_instances.size();
+            for (size_t i = first; i < end; ++i) {
+                m_instances.push_back(m_transforms[m_packets[m_entries[i].packet].transform]);
+            }
+        }
+        m_batches.push_back(batch);
+        first = end;
+    }
+}
+
+void RenderQueue::UploadInstances()
+{
+    if (m_instances.empty()) {
+        return;
+    }
+    if (m_instanceBuffer == 0) {
+        glGenBuffers(1, &m_instanceBuffer);
+    }
+
+    // Respecifying the whole store orphans last frame's, so the upload never waits on draws still reading it
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(glm::mat4), m_instances.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderQueue::Bind(const DrawPacket& packet, GLuint program, BoundState& bound, RenderQueueStats& stats)
+{
+    if (program != bound.program) {
+        glUseProgram(program);
+        bound.program = program;
+        stats.programChanges++;
+    }
+    if (packet.vao != bound.vao) {
+        glBindVertexArray(packet.vao);
+        bound.vao = packet.vao;
+        stats.vaoChanges++;
+    }
+    // Parts without a material draw with no 2D texture bound
+    if (packet.layer < 0 && packet.texture != bound.texture) {
+        glBindTexture(GL_TEXTURE_2D, packet.texture);
+        bound.texture = packet.texture;
+        stats.textureChanges++;
+    }
+    else if (packet.layer >= 0 && packet.texture != bound.textureArray) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, packet.texture);
+        glActiveTexture(GL_TEXTURE0);
+        bound.textureArray = packet.texture;
+        stats.textureChanges++;
+    }
+}
+
+bool RenderQueue::SameDraw(const DrawPacket& a, const DrawPacket& b)
+{
+    return a.part == b.part && a.vao == b.vao && a.firstIndex == b.firstIndex && a.indexCount == b.indexCount
+        && a.program == b.program && a.instancedProgram == b.instancedProgram && a.texture == b.texture && a.layer == b.layer;
+}
@@ -0,0 +1,292 @@
+#include "shaderLibrary.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "engineLog.h"
+#include "hash.h"
+#include "mappedFile.h"
+#include "uniformBuffers.h"
+#include "vfs.h"
+
+namespace {
+
+    constexpr char BINARY_MAGIC[4] = { 'G', 'P', 'R', 'G' };
+    constexpr GLenum PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+    constexpr GLenum PROGRAM_BINARY_LENGTH = 0x8741;
+    constexpr GLenum NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+
+    bool HasExtension(const char* extension)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (name && strcmp(name, extension) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string GlString(GLenum name)
+    {
+        const char* value = reinterpret_cast<const char*>(glGetString(name));
+        return value ? value : "";
+    }
+
+}
+
+ShaderLibrary& ShaderLibrary::Shared()
+{
+    static ShaderLibrary library;
+    return library;
+}
+
+bool ShaderLibrary::EnableBinaryCache(const std::string& directory, GLADloadproc getProcAddress)
+{
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor < 41 && !HasExtension("GL_ARB_get_program_binary")) {
+        return false;
+    }
+
+    GLint formats = 0;
+    glGetIntegerv(NUM_PROGRAM_BINARY_FORMATS, &formats);
+    m_getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(getProcAddress("glGetProgramBinary"));
+    m_programBinary = reinterpret_cast<ProgramBinaryProc>(getProcAddress("glProgramBinary"));
+    m_programParameteri = reinterpret_cast<ProgramParameteriProc>(getProcAddress("glProgramParameteri"));
+    if (formats == 0 || !m_getProgramBinary || !m_programBinary || !m_programParameteri) {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        return false;
+    }
+
+    // Binaries only load into the driver build that wrote them
+    m_driverHash = Hash::Fnv1a64(GlString(GL_VENDOR) + "|" + GlString(GL_RENDERER) + "|" + GlString(GL_VERSION));
+    m_binaryDirectory = directory;
+    return true;
+}
+
+std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+{
+    std::string key = Vfs::Normalize(vertexPath) + "|" + Vfs::Normalize(fragmentPath);
+    for (const std::string& define : defines) {
+        key += "|" + define;
+    }
+
+    m_stats.requests++;
+    auto existing = m_shaders.find(key);
+    if (existing != m_shaders.end()) {
+        return existing->second;
+    }
+
+    std::string vertexSource;
+    std::string fragmentSource;
+    if (!Vfs::Shared().ReadText(vertexPath, vertexSource) || !Vfs::Shared().ReadText(fragmentPath, fragmentSource)) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << ", " << fragmentPath << std::endl;
+        return nullptr;
+    }
+    vertexSource = InsertDefines(vertexSource, defines);
+    fragmentSource = InsertDefines(fragmentSource, defines);
+
+    auto start = std::chrono::steady_clock::now();
+    std::string name = std::filesystem::path(vertexPath).filename().string() + " + " + std::filesystem::path(fragmentPath).filename().string();
+    uint64_t sourceHash = Hash::Combine(Hash::Xxh64(vertexSource.data(), vertexSource.size()), Hash::Xxh64(fragmentSource.data(), fragmentSource.size()));
+
+    bool fromBinary = true;
+    GLuint program = LoadBinary(sourceHash);
+    if (program == 0) {
+        fromBinary = false;
+        program = Compile(vertexSource, fragmentSource, name);
+        if (program != 0) {
+            SaveBinary(program, sourceHash);
+        }
+    }
+    if (program == 0) {
+        return nullptr;
+    }
+
+    std::chrono::duration<double, std::milli> milliseconds = std::chrono::steady_clock::now() - start;
+    m_stats.milliseconds += milliseconds.count();
+    m_stats.programs++;
+    if (EngineLog::Verbose) {
+        std::cout << (fromBinary ? "Loaded program '" : "Compiled program '") << name << "'" << (fromBinary ? " from the binary cache" : "")
+            << " in " << milliseconds.count() << " ms\n";
+    }
+
+    std::shared_ptr<Shader> shader = std::make_shared<Shader>(program);
+    UniformBuffers::AssignBindings(*shader);
+    m_shaders[key] = shader;
+    return shader;
+}
+
+std::string ShaderLibrary::InsertDefines(const std::string& source, const std::vector<std::string>& defines)
+{
+    if (defines.empty()) {
+        return source;
+    }
+
+    // #version must stay the first statement
+    std::string lines;
+    for (const std::string& define : defines) {
+        lines += "#define " + define + "\n";
+    }
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return lines + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + lines;
+    }
+    return source.substr(0, lineEnd + 1) + lines + source.substr(lineEnd + 1);
+}
+
+std::string ShaderLibrary::BinaryPathFor(uint64_t sourceHash) const
+{
+    std::ostringstream name;
+    name << std::hex << Hash::Combine(sourceHash, m_driverHash) << ".glprog";
+    return (std::filesystem::path(m_binaryDirectory) / name.str()).string();
+}
+
+GLuint ShaderLibrary::LoadBinary(uint64_t sourceHash)
+{
+    if (m_binaryDirectory.empty()) {
+        return 0;
+    }
+
+    MappedFile file(BinaryPathFor(sourceHash));
+    if (!file.IsOpen() || file.Size() < sizeof(ProgramBinaryHeader)) {
+        return 0;
+    }
+    ProgramBinaryHeader header;
+    memcpy(&header, file.Data(), sizeof(header));
+    if (memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || header.version != BINARY_VERSION || header.sourceHash != sourceHash
+        || header.driverHash != m_driverHash || file.Size() - sizeof(header) < header.binarySize) {
+        return 0;
+    }
+
+    // The driver may still refuse a binary it wrote, e.g. after a settings change; compiling is the fallback
+    GLuint program = glCreateProgram();
+    m_programBinary(program, header.binaryFormat, file.Data() + sizeof(header), static_cast<GLsizei>(header.binarySize));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    m_stats.binaryLoads++;
+    return program;
+}
+
+void ShaderLibrary::SaveBinary(GLuint program, uint64_t sourceHash)
+{
+    if (m_binaryDirectory.empty()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    ProgramBinaryHeader header = {};
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.sourceHash = sourceHash;
+    header.driverHash = m_driverHash;
+    GLsizei written = 0;
+    m_getProgramBinary(program, length, &written, &header.binaryFormat, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    header.binarySize = static_cast<uint32_t>(written);
+
+    // Write to a temporary file first so a reader never maps a half-written binary
+    std::string path = BinaryPathFor(sourceHash);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file.good()) {
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (!error) {
+        m_stats.binaryWrites++;
+    }
+}
+
+GLuint ShaderLibrary::Compile(const std::string& vertexSource, const std::string& fragmentSource, const std::string& name)
+{
+    const char* vertexCode = vertexSource.c_str();
+    const char* fragmentCode = fragmentSource.c_str();
+
+    GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vertexCode, NULL);
+    glCompileShader(vertex);
+    GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fragmentCode, NULL);
+    glCompileShader(fragment);
+    bool vertexCompiled = CheckStatus(vertex, GL_COMPILE_STATUS, name + " (vertex)");
+    bool fragmentCompiled = CheckStatus(fragment, GL_COMPILE_STATUS, name + " (fragment)");
+    bool compiled = vertexCompiled && fragmentCompiled;
+
+    GLuint program = glCreateProgram();
+    if (compiled) {
+        if (!m_binaryDirectory.empty()) {
+            m_programParameteri(program, PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+    }
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    if (!compiled || !CheckStatus(program, GL_LINK_STATUS, name)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    m_stats.compiled++;
+    return program;
+}
+
+bool ShaderLibrary::CheckStatus(GLuint object, GLenum status, const std::string& what)
+{
+    GLint success = GL_FALSE;
+    GLchar infoLog[1024];
+    if (status == GL_LINK_STATUS) {
+        glGetProgramiv(object, status, &success);
+        if (!success) {
+            glGetProgramInfoLog(object, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of " << what << "\n" << infoLog << std::endl;
+        }
+    }
+    else {
+        glGetShaderiv(object, status, &success);
+        if (!success) {
+            glGetShaderInfoLog(object, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of " << what << "\n" << infoLog << std::endl;
+        }
+    }
+    return success == GL_TRUE;
+}
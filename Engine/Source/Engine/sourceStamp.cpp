@@ -0,0 +1,63 @@
+#include "sourceStamp.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "hash.h"
+#include "mappedFile.h"
+#include "vfs.h"
+
+bool SourceStamp::Describe(const std::string& sourcePath, SourceStamp& stamp)
+{
+    std::error_code error;
+    stamp.size = std::filesystem::file_size(sourcePath, error);
+    if (error) {
+        return false;
+    }
+
+    auto modified = std::filesystem::last_write_time(sourcePath, error);
+    if (error) {
+        return false;
+    }
+
+    stamp.modifiedTime = static_cast<int64_t>(modified.time_since_epoch().count());
+    return true;
+}
+
+bool SourceStamp::Matches(const std::string& sourcePath, SourceStamp& stamp)
+{
+    // Archived sources carry the hash they were packed with, and the archive wins over the disk
+    uint64_t archivedHash = 0;
+    uint64_t archivedSize = 0;
+    if (Vfs::Shared().ArchivedContentHash(sourcePath, archivedHash, archivedSize)) {
+        return archivedSize == stamp.size && archivedHash == stamp.contentHash;
+    }
+
+    SourceStamp current;
+    if (!Describe(sourcePath, current) || current.size != stamp.size) {
+        return false;
+    }
+
+    // A touched but unchanged source still matches by content
+    if (current.modifiedTime != stamp.modifiedTime) {
+        MappedFile sourceFile(sourcePath);
+        if (!sourceFile.IsOpen() || Hash::Xxh64(sourceFile.Data(), sourceFile.Size()) != stamp.contentHash) {
+            return false;
+        }
+        stamp.modifiedTime = current.modifiedTime;
+    }
+
+    return true;
+}
+
+bool SourceStamp::StoreModifiedTime(const std::string& bakedPath, uint64_t offset, int64_t modifiedTime)
+{
+    // Patched in place rather than rewritten: readers see either time, and both match the source
+    std::fstream file(bakedPath, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) {
+        return false;
+    }
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<const char*>(&modifiedTime), sizeof(modifiedTime));
+    return static_cast<bool>(file);
+}
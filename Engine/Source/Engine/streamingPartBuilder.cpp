@@ -0,0 +1,208 @@
+#include "streamingPartBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+StreamingPartBuilder::StreamingPartBuilder(size_t faceCount, VertexFormat format, const PositionDequantization& dequantization, size_t windowBytes)
+{
+    m_format = format;
+    m_dequantization = dequantization;
+    m_stride = VertexFormats::Stride(format);
+    m_maxVertices = std::max<size_t>(faceCount * 3, 1);
+    m_indexType = m_maxVertices <= UINT16_MAX + 1u ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    m_indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    m_windowVertices = std::max<size_t>(windowBytes / m_stride, 3);
+    // Whole triangles per index window so a face never straddles two mappings
+    m_windowIndices = std::max<size_t>(windowBytes / m_indexSize / 3, 1) * 3;
+
+    m_boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    m_boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+    // Storage only; every byte arrives through a mapped window
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_maxVertices * m_stride, nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, faceCount * 3 * m_indexSize, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    size_t tableSize = 16;
+    while (tableSize < std::min(m_windowVertices, m_maxVertices) * 2) {
+        tableSize <<= 1;
+    }
+    m_dedup.resize(tableSize);
+}
+
+StreamingPartBuilder::~StreamingPartBuilder()
+{
+    // Only left set when Finish was never reached
+    Unmap(m_vbo, m_vertexWindow);
+    Unmap(m_ebo, m_indexWindow);
+    if (m_vbo != 0) {
+        glDeleteBuffers(1, &m_vbo);
+    }
+    if (m_ebo != 0) {
+        glDeleteBuffers(1, &m_ebo);
+    }
+}
+
+bool StreamingPartBuilder::AddTriangle(const ObjData& data, const ObjCorner* corners)
+{
+    if (m_indexCount == m_indexWindowEnd && !MapIndexWindow()) {
+        return false;
+    }
+
+    const glm::vec3& a = data.positions[corners[0].position];
+    const glm::vec2& uvA = data.uvs[corners[0].uv];
+    glm::vec3 ab = data.positions[corners[1].position] - a;
+    glm::vec3 ac = data.positions[corners[2].position] - a;
+    glm::vec2 uvAb = data.uvs[corners[1].uv] - uvA;
+    glm::vec2 uvAc = data.uvs[corners[2].uv] - uvA;
+    m_positionArea += glm::length(glm::cross(ab, ac));
+    m_uvArea += std::abs(uvAb.x * uvAc.y - uvAc.x * uvAb.y);
+
+    for (size_t k = 0; k < 3; ++k) {
+        uint32_t vertex;
+        if (!AddVertex(data, corners[k], vertex)) {
+            return false;
+        }
+        unsigned char* target = m_indexWindow + (m_indexCount - m_indexWindowStart) * m_indexSize;
+        if (m_indexType == GL_UNSIGNED_SHORT) {
+            uint16_t index = static_cast<uint16_t>(vertex);
+            memcpy(target, &index, sizeof(index));
+        }
+        else {
+            memcpy(target, &vertex, sizeof(vertex));
+        }
+        m_indexCount++;
+    }
+    return true;
+}
+
+bool StreamingPartBuilder::AddVertex(const ObjData& data, const ObjCorner& corner, uint32_t& index)
+{
+    size_t mask = m_dedup.size() - 1;
+    uint64_t hash = (corner.position * 0x9E3779B97F4A7C15ull) ^ (corner.uv * 0xC2B2AE3D27D4EB4Full) ^ (corner.normal * 0x165667B19E3779F9ull);
+    size_t slot = static_cast<size_t>(hash ^ (hash >> 29)) & mask;
+
+    // The table is cleared with every vertex window, so only vertices of the mapped window are found
+    while (m_dedup[slot].vertex != UINT32_MAX) {
+        const ObjCorner& existing = m_dedup[slot].corner;
+        if (existing.position == corner.position && existing.uv == corner.uv && existing.normal == corner.normal) {
+            index = m_dedup[slot].vertex;
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (m_vertexCount == m_vertexWindowEnd) {
+        if (!MapVertexWindow()) {
+            return false;
+        }
+        // The table was cleared, so the slot found above may no longer be the first free one
+        slot = static_cast<size_t>(hash ^ (hash >> 29)) & mask;
+    }
+
+    Vertex vertex{ data.positions[corner.position], data.uvs[corner.uv], data.normals[corner.normal] };
+    VertexFormats::PackVertex(m_format, vertex, m_dequantization, m_vertexWindow + (m_vertexCount - m_vertexWindowStart) * m_stride);
+    m_boundsMin = glm::min(m_boundsMin, vertex.position);
+    m_boundsMax = glm::max(m_boundsMax, vertex.position);
+
+    index = static_cast<uint32_t>(m_vertexCount++);
+    m_dedup[slot] = { corner, index };
+    return true;
+}
+
+bool StreamingPartBuilder::MapVertexWindow()
+{
+    Unmap(m_vbo, m_vertexWindow);
+
+    m_vertexWindowStart = m_vertexCount;
+    m_vertexWindowEnd = std::min(m_vertexCount + m_windowVertices, m_maxVertices);
+    std::fill(m_dedup.begin(), m_dedup.end(), DedupEntry{ {}, UINT32_MAX });
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    m_vertexWindow = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, m_vertexWindowStart * m_stride,
+        (m_vertexWindowEnd - m_vertexWindowStart) * m_stride, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return m_vertexWindow != nullptr;
+}
+
+bool StreamingPartBuilder::MapIndexWindow()
+{
+    Unmap(m_ebo, m_indexWindow);
+
+    m_indexWindowStart = m_indexCount;
+    m_indexWindowEnd = std::min(m_indexCount + m_windowIndices, m_maxVertices);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    m_indexWindow = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, m_indexWindowStart * m_indexSize,
+        (m_indexWindowEnd - m_indexWindowStart) * m_indexSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return m_indexWindow != nullptr;
+}
+
+void StreamingPartBuilder::Unmap(GLuint buffer, unsigned char*& window)
+{
+    if (!window) {
+        return;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    window = nullptr;
+}
+
+void StreamingPartBuilder::Finish(ModelPart& part, GLuint& VAO, GLuint& VBO, GLuint& EBO)
+{
+    Unmap(m_vbo, m_vertexWindow);
+    Unmap(m_ebo, m_indexWindow);
+
+    // Window-local dedup usually leaves the buffer sized for every corner well under-used; shrink it
+    // with a GPU-side copy rather than another pass over the CPU
+    size_t usedBytes = m_vertexCount * m_stride;
+    if (usedBytes > 0 && usedBytes * 4 < m_maxVertices * m_stride * 3) {
+        GLuint trimmed;
+        glGenBuffers(1, &trimmed);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, trimmed);
+        glBufferData(GL_COPY_WRITE_BUFFER, usedBytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &m_vbo);
+        m_vbo = trimmed;
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    VertexFormats::SetupAttributes(m_format);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBindVertexArray(0);
+
+    part.vertexCount = static_cast<unsigned int>(m_vertexCount);
+    part.indexCount = static_cast<unsigned int>(m_indexCount);
+    part.indexType = m_indexType;
+    part.vertexFormat = m_format;
+    part.dequantization = m_dequantization;
+    part.lods.assign(1, { 0, part.indexCount, 0.0f });
+    part.uvDensity = UvDensity(m_positionArea, m_uvArea);
+    if (m_vertexCount > 0) {
+        part.boundsMin = m_boundsMin;
+        part.boundsMax = m_boundsMax;
+    }
+    else {
+        part.boundsMin = part.boundsMax = glm::vec3(0.0f);
+    }
+
+    VBO = m_vbo;
+    EBO = m_ebo;
+    m_vbo = 0;
+    m_ebo = 0;
+}
@@ -0,0 +1,834 @@
+#include "textureCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "blockCompression.h"
+#include "engineLog.h"
+#include "mipGenerator.h"
+#include "textureCompressor.h"
+#include "threadPool.h"
+
+TextureCache& TextureCache::Shared()
+{
+    static TextureCache cache;
+    return cache;
+}
+
+std::string TextureCache::MakeKey(const std::string& resolvedPath, const TextureSampler& sampler, bool asLayer)
+{
+    return resolvedPath + "|" + std::to_string(sampler.wrap) + "|" + std::to_string(sampler.minFilter) + "|"
+        + std::to_string(sampler.magFilter) + "|" + (sampler.mipmaps ? "mips" : "nomips") + (asLayer ? "|layer" : "");
+}
+
+TextureCache::Entry& TextureCache::FindOrCreate(const std::string& imagePath, const TextureSampler& sampler, bool asLayer)
+{
+    std::error_code error;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(imagePath, error);
+    std::string path = error ? imagePath : resolved.string();
+    std::string key = MakeKey(path, sampler, asLayer);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<Entry>& entry = m_entries[key];
+    if (!entry) {
+        entry = std::make_unique<Entry>();
+        entry->key = key;
+        entry->path = path;
+        entry->sampler = sampler;
+        entry->isLayer = asLayer;
+        entry->streamed = !asLayer && sampler.mipmaps && m_streamingBudget > 0;
+    }
+    entry->pins++;
+    return *entry;
+}
+
+TextureCache::EntryPin::~EntryPin()
+{
+    std::lock_guard<std::mutex> lock(m_cache.m_mutex);
+    m_entry.pins--;
+}
+
+void TextureCache::DecodeImage(const std::string& path, bool withChain, ImageData& image, KtxFile& baked, std::vector<ImageData>& chain)
+{
+    // A baked file built from the current image skips the decode entirely: block-compressed
+    // levels first, then the uncompressed mip chain
+    for (const std::string& bakedPath : { TextureCompressor::CompressedPathFor(path), MipGenerator::MipsPathFor(path) }) {
+        if (baked.Open(bakedPath) && baked.IsFreshFor(path)) {
+            return;
+        }
+    }
+    baked = KtxFile();
+
+    image = ImageData::Load(path);
+    if (!image.IsValid()) {
+        std::cout << "Failed to load texture: " << path << std::endl;
+    }
+    else if (withChain) {
+        chain = MipGenerator::GenerateChain(image);
+        image = ImageData();
+    }
+}
+
+void TextureCache::Decode(Entry& entry)
+{
+    std::call_once(entry.decoded, [&]() {
+        DecodeImage(entry.path, entry.isLayer || entry.streamed, entry.image, entry.baked, entry.chain);
+        if (entry.baked.IsOpen()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.decodes++;
+    });
+}
+
+void TextureCache::Prefetch(const std::string& imagePath, const TextureSampler& sampler, bool asLayer)
+{
+    Entry& entry = FindOrCreate(imagePath, sampler, asLayer);
+    EntryPin pin(*this, entry);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (entry.texture != 0) {
+            return;
+        }
+    }
+
+    Decode(entry);
+}
+
+GLuint TextureCache::Acquire(const std::string& imagePath, const TextureSampler& sampler)
+{
+    Entry& entry = FindOrCreate(imagePath, sampler, false);
+    EntryPin pin(*this, entry);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.requests++;
+        if (entry.texture != 0) {
+            m_stats.hits++;
+            m_stats.savedBytes += entry.bytes;
+            entry.refCount++;
+            return entry.texture;
+        }
+    }
+
+    Decode(entry);
+    GLuint texture = 0;
+    uint64_t bytes = 0;
+    bool baked = entry.baked.IsOpen();
+    bool compressed = baked && entry.baked.IsCompressed();
+    MipLevels levels;
+    if (entry.streamed) {
+        if (PrepareLevels(entry.baked, entry.chain, entry.sampler, levels)) {
+            glGenTextures(1, &texture);
+            bytes = UploadStreamed(entry, texture, levels);
+        }
+    }
+    else if (baked) {
+        texture = Upload(entry.baked, entry.sampler, bytes);
+    }
+    else if (entry.image.IsValid()) {
+        texture = Upload(entry.image, entry.sampler);
+        bytes = entry.image.ByteSize();
+        if (entry.sampler.mipmaps) {
+            bytes = bytes * 4 / 3;
+        }
+    }
+    if (texture == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry.texture = texture;
+    entry.bytes = bytes;
+    entry.refCount++;
+    entry.image = ImageData();
+    entry.baked = KtxFile();
+    entry.chain = std::vector<ImageData>();
+    if (compressed) {
+        m_stats.compressedTextures++;
+    }
+    if (entry.streamed) {
+        m_streamedEntries.push_back(&entry);
+        m_stats.streamedTextures++;
+    }
+    m_entriesByTexture[texture] = &entry;
+    m_stats.residentTextures++;
+    m_stats.residentBytes += bytes;
+    return texture;
+}
+
+TextureLayer TextureCache::AcquireLayer(const std::string& imagePath, const TextureSampler& sampler)
+{
+    Entry& entry = FindOrCreate(imagePath, sampler, true);
+    EntryPin pin(*this, entry);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.requests++;
+        if (entry.texture != 0) {
+            m_stats.hits++;
+            m_stats.savedBytes += entry.bytes;
+            entry.refCount++;
+            return { entry.texture, entry.layer };
+        }
+    }
+
+    Decode(entry);
+    MipLevels image;
+    if (!PrepareLevels(entry.baked, entry.chain, entry.sampler, image)) {
+        return {};
+    }
+
+    uint32_t layer = 0;
+    ArrayPage* page = AllocateLayer(image, entry.sampler, layer);
+    UploadLayer(*page, layer, image);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry.texture = page->texture;
+    entry.layer = layer;
+    entry.bytes = image.bytes;
+    entry.refCount++;
+    entry.baked = KtxFile();
+    entry.chain = std::vector<ImageData>();
+    if (image.glType == 0) {
+        m_stats.compressedTextures++;
+    }
+    m_entriesByLayer[LayerKey(entry.texture, layer)] = &entry;
+    m_stats.residentTextures++;
+    m_stats.arrayLayers++;
+    return { entry.texture, layer };
+}
+
+bool TextureCache::PrepareLevels(const KtxFile& baked, const std::vector<ImageData>& chain, const TextureSampler& sampler, MipLevels& layer)
+{
+    layer = MipLevels();
+    if (baked.IsOpen()) {
+        const KtxHeader& header = baked.Header();
+        BlockFormat format;
+        bool blockCompressed = baked.IsCompressed() && BlockCompression::FromGlInternalFormat(header.glInternalFormat, format);
+        if (baked.IsCompressed() && !blockCompressed) {
+            return false;
+        }
+
+        layer.levels = baked.Levels();
+        if (blockCompressed && format != BlockFormat::BC5 && !SupportsS3tc()) {
+            // Same fallback as the 2D path: decode the blocks and store the layer as RGBA8
+            for (KtxLevel& level : layer.levels) {
+                layer.storage.push_back(BlockCompression::Decode(format, level.data, level.width, level.height));
+                level.data = layer.storage.back().data();
+                level.size = layer.storage.back().size();
+            }
+            layer.internalFormat = GL_RGBA8;
+            layer.glFormat = GL_RGBA;
+            layer.glType = GL_UNSIGNED_BYTE;
+        }
+        else {
+            layer.internalFormat = header.glInternalFormat;
+            layer.glFormat = header.glFormat;
+            layer.glType = header.glType;
+        }
+    }
+    else if (!chain.empty()) {
+        for (const ImageData& level : chain) {
+            layer.levels.push_back({ level.pixels.data(), level.pixels.size(), level.width, level.height });
+        }
+        layer.internalFormat = GL_RGBA8;
+        layer.glFormat = GL_RGBA;
+        layer.glType = GL_UNSIGNED_BYTE;
+    }
+    else {
+        return false;
+    }
+
+    if (!sampler.mipmaps) {
+        layer.levels.resize(1);
+    }
+    for (const KtxLevel& level : layer.levels) {
+        layer.bytes += level.size;
+    }
+    return true;
+}
+
+TextureCache::ArrayPage* TextureCache::AllocateLayer(const MipLevels& image, const TextureSampler& sampler, uint32_t& layer)
+{
+    const KtxLevel& base = image.levels[0];
+    for (const std::unique_ptr<ArrayPage>& page : m_arrayPages) {
+        if (!page->freeLayers.empty() && page->internalFormat == image.internalFormat && page->width == base.width
+            && page->height == base.height && page->levels == image.levels.size() && page->sampler == sampler) {
+            layer = page->freeLayers.back();
+            page->freeLayers.pop_back();
+            return page.get();
+        }
+    }
+
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    auto page = std::make_unique<ArrayPage>();
+    page->internalFormat = image.internalFormat;
+    page->width = base.width;
+    page->height = base.height;
+    page->levels = image.levels.size();
+    page->sampler = sampler;
+    page->layerBytes = image.bytes;
+    page->capacity = static_cast<uint32_t>(std::clamp<uint64_t>(ARRAY_PAGE_BYTES / std::max<uint64_t>(image.bytes, 1), 4, std::min<GLint>(64, maxLayers)));
+    for (uint32_t i = page->capacity; i-- > 0; ) {
+        page->freeLayers.push_back(i);
+    }
+
+    glGenTextures(1, &page->texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, page->texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(page->levels - 1));
+
+    // Storage for every layer, filled one layer at a time as images arrive
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const KtxLevel& level = image.levels[i];
+        GLint mip = static_cast<GLint>(i);
+        if (image.glType == 0) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, mip, image.internalFormat, level.width, level.height, page->capacity, 0,
+                static_cast<GLsizei>(level.size * page->capacity), nullptr);
+        }
+        else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, image.internalFormat, level.width, level.height, page->capacity, 0, image.glFormat, image.glType, nullptr);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.arrayTextures++;
+        m_stats.residentBytes += page->layerBytes * page->capacity;
+    }
+
+    layer = page->freeLayers.back();
+    page->freeLayers.pop_back();
+    m_arrayPages.push_back(std::move(page));
+    return m_arrayPages.back().get();
+}
+
+TextureCache::ArrayPage* TextureCache::FindPage(GLuint texture)
+{
+    for (const std::unique_ptr<ArrayPage>& page : m_arrayPages) {
+        if (page->texture == texture) {
+            return page.get();
+        }
+    }
+    return nullptr;
+}
+
+void TextureCache::UploadLayer(const ArrayPage& page, uint32_t layer, const MipLevels& image)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const KtxLevel& level = image.levels[i];
+        GLint mip = static_cast<GLint>(i);
+        if (image.glType == 0) {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, static_cast<GLint>(layer), level.width, level.height, 1,
+                image.internalFormat, static_cast<GLsizei>(level.size), level.data);
+        }
+        else {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, static_cast<GLint>(layer), level.width, level.height, 1, image.glFormat, image.glType, level.data);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureCache::Release(GLuint texture)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entriesByTexture.find(texture);
+    if (entry != m_entriesByTexture.end() && entry->second->refCount > 0) {
+        entry->second->refCount--;
+    }
+}
+
+void TextureCache::Release(const TextureLayer& layer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entriesByLayer.find(LayerKey(layer.texture, layer.layer));
+    if (entry != m_entriesByLayer.end() && entry->second->refCount > 0) {
+        entry->second->refCount--;
+    }
+}
+
+void TextureCache::Trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        Entry& entry = *it->second;
+        if (entry.refCount > 0 || entry.pins > 0) {
+            ++it;
+            continue;
+        }
+        // Decoded by a Prefetch nobody followed up with an Acquire; only its CPU copy goes
+        if (entry.texture == 0) {
+            it = m_entries.erase(it);
+            continue;
+        }
+
+        if (entry.isLayer) {
+            // The page keeps its storage; the layer is reused by the next image of that shape
+            FindPage(entry.texture)->freeLayers.push_back(entry.layer);
+            m_entriesByLayer.erase(LayerKey(entry.texture, entry.layer));
+            m_stats.arrayLayers--;
+        }
+        else {
+            glDeleteTextures(1, &entry.texture);
+            m_entriesByTexture.erase(entry.texture);
+            m_stats.residentBytes -= entry.bytes;
+            if (entry.streamed) {
+                m_streamedEntries.erase(std::find(m_streamedEntries.begin(), m_streamedEntries.end(), &entry));
+                m_stats.streamedTextures--;
+            }
+        }
+        m_stats.residentTextures--;
+        it = m_entries.erase(it);
+    }
+
+    auto empty = std::remove_if(m_arrayPages.begin(), m_arrayPages.end(), [&](const std::unique_ptr<ArrayPage>& page) {
+        if (page->freeLayers.size() < page->capacity) {
+            return false;
+        }
+        glDeleteTextures(1, &page->texture);
+        m_stats.arrayTextures--;
+        m_stats.residentBytes -= page->layerBytes * page->capacity;
+        return true;
+    });
+    m_arrayPages.erase(empty, m_arrayPages.end());
+}
+
+size_t TextureCache::Reload(const std::string& changedPath, std::chrono::steady_clock::time_point changed)
+{
+    // A rebaked .ktx stands for the image it was baked from
+    std::string imagePath = changedPath;
+    for (const std::string& suffix : { std::string(".mips.ktx"), std::string(".ktx") }) {
+        if (imagePath.size() > suffix.size() && imagePath.compare(imagePath.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            imagePath.resize(imagePath.size() - suffix.size());
+            break;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(imagePath, error);
+    std::string path = error ? imagePath : resolved.string();
+
+    // Textures only decoded so far are left alone; their upload picks up whatever they decoded
+    std::vector<std::pair<std::string, bool>> keys;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& [key, entry] : m_entries) {
+            if (entry->path == path && entry->texture != 0) {
+                keys.emplace_back(key, entry->isLayer || entry->streamed);
+            }
+        }
+    }
+
+    auto reloads = m_reloads;
+    for (const auto& [key, withChain] : keys) {
+        ThreadPool::Shared().Submit([reloads, key, withChain, path, changed]() {
+            PendingReload reload;
+            reload.key = key;
+            reload.changed = changed;
+            DecodeImage(path, withChain, reload.image, reload.baked, reload.chain);
+            reloads->Push(std::move(reload));
+        });
+    }
+    return keys.size();
+}
+
+void TextureCache::ProcessReloads()
+{
+    while (std::optional<PendingReload> reload = m_reloads->Pop()) {
+        // Trim runs on this thread too, so the entry cannot go away between the lookup and the upload
+        Entry* entry = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_entries.find(reload->key);
+            if (found != m_entries.end() && found->second->texture != 0) {
+                entry = found->second.get();
+            }
+        }
+        if (!entry) {
+            continue;
+        }
+
+        uint64_t bytes = 0;
+        bool compressed = reload->baked.IsOpen() && reload->baked.IsCompressed();
+        if (entry->isLayer) {
+            // A layer can only be rewritten in place; a new size or format needs a page of its own
+            MipLevels image;
+            ArrayPage* page = FindPage(entry->texture);
+            if (!PrepareLevels(reload->baked, reload->chain, entry->sampler, image) || image.internalFormat != page->internalFormat
+                || image.levels[0].width != page->width || image.levels[0].height != page->height || image.levels.size() != page->levels) {
+                std::cout << "Texture '" << entry->path << "' changed shape; it keeps its old image until it is loaded again\n";
+                continue;
+            }
+            UploadLayer(*page, entry->layer, image);
+            bytes = entry->bytes;
+        }
+        else if (entry->streamed) {
+            MipLevels levels;
+            if (!PrepareLevels(reload->baked, reload->chain, entry->sampler, levels)) {
+                continue;
+            }
+            bytes = UploadStreamed(*entry, entry->texture, levels);
+        }
+        else if (reload->baked.IsOpen()) {
+            if (Upload(reload->baked, entry->sampler, bytes, entry->texture) == 0) {
+                continue;
+            }
+        }
+        else if (reload->image.IsValid()) {
+            Upload(reload->image, entry->sampler, entry->texture);
+            bytes = reload->image.ByteSize();
+            if (entry->sampler.mipmaps) {
+                bytes = bytes * 4 / 3;
+            }
+        }
+        else {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.residentBytes = m_stats.residentBytes - entry->bytes + bytes;
+            entry->bytes = bytes;
+            if (compressed) {
+                m_stats.compressedTextures++;
+            }
+            if (!reload->baked.IsOpen()) {
+                m_stats.decodes++;
+            }
+        }
+
+        std::chrono::duration<double, std::milli> milliseconds = std::chrono::steady_clock::now() - reload->changed;
+        if (EngineLog::Verbose) {
+            std::cout << "Reloaded texture '" << entry->path << "' " << milliseconds.count() << " ms after it changed\n";
+        }
+    }
+}
+
+void TextureCache::SetStreamingBudget(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streamingBudget = bytes;
+    m_stats.streamingBudget = bytes;
+}
+
+void TextureCache::RequestDetail(GLuint texture, float uvPerPixel)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_entriesByTexture.find(texture);
+    if (found == m_entriesByTexture.end() || !found->second->streamed) {
+        return;
+    }
+
+    // Level 0 maps one texel to a pixel at `texelsPerPixel` 1; every level above halves it
+    Entry& entry = *found->second;
+    size_t coarsest = entry.levelBytes.size() - 1;
+    float texelsPerPixel = uvPerPixel * std::max(entry.width, entry.height);
+    size_t level = coarsest;
+    if (texelsPerPixel > 0.0f) {
+        level = std::min(static_cast<size_t>(std::max(std::log2(texelsPerPixel), 0.0f)), coarsest);
+    }
+
+    if (entry.lastVisibleFrame != m_frame) {
+        entry.lastVisibleFrame = m_frame;
+        entry.wantedBase = level;
+    }
+    else {
+        entry.wantedBase = std::min(entry.wantedBase, level);
+    }
+}
+
+void TextureCache::UpdateStreaming()
+{
+    if (m_streamingBudget == 0) {
+        return;
+    }
+
+    while (std::optional<PendingStream> stream = m_streams->Pop()) {
+        Entry* entry = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_entries.find(stream->key);
+            if (found != m_entries.end() && found->second->texture != 0) {
+                entry = found->second.get();
+            }
+        }
+        if (!entry) {
+            continue;
+        }
+
+        // A reload may have changed the image while it was read; the next request reads it again
+        entry->streaming = false;
+        MipLevels levels;
+        if (stream->firstLevel >= entry->residentBase || !PrepareLevels(stream->baked, stream->chain, entry->sampler, levels)
+            || levels.levels.size() != entry->levelBytes.size() || levels.levels[0].width != entry->width || levels.levels[0].height != entry->height) {
+            continue;
+        }
+
+        // Coarser levels first, for as long as the budget has room for them
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t first = entry->residentBase;
+        uint64_t bytes = 0;
+        while (first > stream->firstLevel && MakeRoom(bytes + entry->levelBytes[first - 1], entry)) {
+            bytes += entry->levelBytes[--first];
+        }
+        if (first == entry->residentBase) {
+            continue;
+        }
+
+        UploadLevels(entry->texture, levels, first, entry->residentBase);
+        glBindTexture(GL_TEXTURE_2D, entry->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(first));
+        glBindTexture(GL_TEXTURE_2D, 0);
+        entry->residentBase = first;
+        entry->bytes += bytes;
+        m_stats.residentBytes += bytes;
+        m_stats.streamedInBytes += bytes;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto streams = m_streams;
+    uint64_t partial = 0;
+    for (Entry* entry : m_streamedEntries) {
+        if (entry->lastVisibleFrame != m_frame || entry->wantedBase >= entry->residentBase) {
+            continue;
+        }
+
+        // Only read when the next level fits; otherwise this would read the file again every frame
+        partial++;
+        if (!entry->streaming && MakeRoom(entry->levelBytes[entry->residentBase - 1], entry)) {
+            entry->streaming = true;
+            ThreadPool::Shared().Submit([streams, key = entry->key, path = entry->path, first = entry->wantedBase]() {
+                PendingStream stream;
+                stream.key = key;
+                stream.firstLevel = first;
+                ImageData image;
+                DecodeImage(path, true, image, stream.baked, stream.chain);
+                streams->Push(std::move(stream));
+            });
+        }
+    }
+    m_stats.partialTextures = partial;
+
+    // Textures uploaded whole (array pages, unmipmapped ones) count against the budget too
+    MakeRoom(0, nullptr);
+    m_frame++;
+}
+
+uint64_t TextureCache::UploadStreamed(Entry& entry, GLuint texture, const MipLevels& levels)
+{
+    // A reloaded image of the same shape keeps the levels it had; anything else starts again from its tail
+    const std::vector<KtxLevel>& chain = levels.levels;
+    bool sameShape = entry.levelBytes.size() == chain.size() && entry.width == chain[0].width && entry.height == chain[0].height;
+    size_t previousBase = entry.levelBytes.empty() ? 0 : entry.residentBase;
+
+    entry.width = chain[0].width;
+    entry.height = chain[0].height;
+    entry.levelBytes.clear();
+    entry.tailBase = chain.size() - 1;
+    for (size_t i = 0; i < chain.size(); ++i) {
+        entry.levelBytes.push_back(chain[i].size);
+        if (entry.tailBase == chain.size() - 1 && std::max(chain[i].width, chain[i].height) <= STREAMING_TAIL_SIZE) {
+            entry.tailBase = i;
+        }
+    }
+    if (!sameShape) {
+        entry.residentBase = entry.tailBase;
+        entry.wantedBase = entry.tailBase;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, entry.sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, entry.sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, entry.sampler.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, entry.sampler.magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(entry.residentBase));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(chain.size() - 1));
+    // Finer levels the previous image had uploaded
+    for (size_t i = previousBase; i < entry.residentBase; ++i) {
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    UploadLevels(texture, levels, entry.residentBase, chain.size());
+    uint64_t bytes = 0;
+    for (size_t i = entry.residentBase; i < chain.size(); ++i) {
+        bytes += entry.levelBytes[i];
+    }
+    return bytes;
+}
+
+void TextureCache::UploadLevels(GLuint texture, const MipLevels& levels, size_t first, size_t end)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = first; i < end; ++i) {
+        const KtxLevel& level = levels.levels[i];
+        GLint mip = static_cast<GLint>(i);
+        if (levels.glType == 0) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, mip, levels.internalFormat, level.width, level.height, 0, static_cast<GLsizei>(level.size), level.data);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, mip, levels.internalFormat, level.width, level.height, 0, levels.glFormat, levels.glType, level.data);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureCache::EvictLevel(Entry& entry)
+{
+    size_t level = entry.residentBase++;
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(entry.residentBase));
+    // Levels under the base level play no part in completeness; an empty image gives back their storage
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entry.bytes -= entry.levelBytes[level];
+    m_stats.residentBytes -= entry.levelBytes[level];
+    m_stats.evictedBytes += entry.levelBytes[level];
+}
+
+bool TextureCache::MakeRoom(uint64_t bytes, const Entry* keep)
+{
+    uint64_t budget = m_streamingBudget;
+    if (budget == 0 || m_stats.residentBytes + bytes <= budget) {
+        return true;
+    }
+
+    // Textures drawn this frame only give up levels finer than they asked for
+    auto evictableBase = [&](const Entry* entry) {
+        return entry->lastVisibleFrame == m_frame ? std::min(entry->wantedBase, entry->tailBase) : entry->tailBase;
+    };
+    std::vector<Entry*> candidates;
+    for (Entry* entry : m_streamedEntries) {
+        if (entry != keep && entry->residentBase < evictableBase(entry)) {
+            candidates.push_back(entry);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) { return a->lastVisibleFrame < b->lastVisibleFrame; });
+
+    for (Entry* entry : candidates) {
+        size_t base = evictableBase(entry);
+        while (entry->residentBase < base && m_stats.residentBytes + bytes > budget) {
+            EvictLevel(*entry);
+        }
+        if (m_stats.residentBytes + bytes <= budget) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TextureCacheStats TextureCache::Stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+GLuint TextureCache::Upload(const ImageData& image, const TextureSampler& sampler, GLuint texture)
+{
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+    // A texture respecified from a baked file may have had its level count capped
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+
+    // Rows of 3-channel images are not 4-byte aligned in general
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (image.channels == 4)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (sampler.mipmaps)
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+GLuint TextureCache::Upload(const KtxFile& baked, const TextureSampler& sampler, uint64_t& bytes, GLuint texture)
+{
+    const KtxHeader& header = baked.Header();
+    const std::vector<KtxLevel>& levels = baked.Levels();
+    size_t levelCount = sampler.mipmaps ? levels.size() : 1;
+
+    // BC1/BC3 need the S3TC extension; without it the blocks are decoded here and uploaded as RGBA
+    BlockFormat format;
+    bool blockCompressed = baked.IsCompressed() && BlockCompression::FromGlInternalFormat(header.glInternalFormat, format);
+    if (baked.IsCompressed() && !blockCompressed) {
+        return 0;
+    }
+    bool decodeOnCpu = blockCompressed && format != BlockFormat::BC5 && !SupportsS3tc();
+
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1));
+
+    bytes = 0;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i < levelCount; ++i) {
+        const KtxLevel& level = levels[i];
+        GLint mip = static_cast<GLint>(i);
+        if (decodeOnCpu) {
+            std::vector<unsigned char> pixels = BlockCompression::Decode(format, level.data, level.width, level.height);
+            glTexImage2D(GL_TEXTURE_2D, mip, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            bytes += pixels.size();
+        }
+        else if (blockCompressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, mip, header.glInternalFormat, level.width, level.height, 0, static_cast<GLsizei>(level.size), level.data);
+            bytes += level.size;
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, mip, header.glInternalFormat, level.width, level.height, 0, header.glFormat, header.glType, level.data);
+            bytes += level.size;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+bool TextureCache::SupportsS3tc()
+{
+    static const bool supported = []() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+                return true;
+            }
+        }
+        return false;
+    }();
+    return supported;
+}
@@ -0,0 +1,87 @@
+#include "textureCompressor.h"
+
+#include <iostream>
+#include <vector>
+
+#include "hash.h"
+#include "ktxFile.h"
+#include "mappedFile.h"
+
+std::string TextureCompressor::CompressedPathFor(const std::string& imagePath)
+{
+    return imagePath + ".ktx";
+}
+
+BlockFormat TextureCompressor::ChooseFormat(const ImageData& image)
+{
+    if (image.channels == 4) {
+        for (size_t i = 3; i < image.pixels.size(); i += 4) {
+            if (image.pixels[i] != 255) {
+                return BlockFormat::BC3;
+            }
+        }
+    }
+    return BlockFormat::BC1;
+}
+
+bool TextureCompressor::Bake(const std::string& imagePath, TextureBakeReport& report, const MipOptions& mipOptions)
+{
+    ImageData image = ImageData::Load(imagePath);
+    if (!image.IsValid()) {
+        std::cerr << "Failed to load texture: " << imagePath << std::endl;
+        return false;
+    }
+    return Bake(imagePath, ChooseFormat(image), report, mipOptions);
+}
+
+bool TextureCompressor::Bake(const std::string& imagePath, BlockFormat format, TextureBakeReport& report, const MipOptions& mipOptions)
+{
+    SourceStamp source;
+    MappedFile sourceFile(imagePath);
+    if (!sourceFile.IsOpen() || !SourceStamp::Describe(imagePath, source)) {
+        std::cerr << "Failed to open texture: " << imagePath << std::endl;
+        return false;
+    }
+    source.contentHash = Hash::Xxh64(sourceFile.Data(), sourceFile.Size());
+
+    ImageData image = ImageData::Load(imagePath);
+    if (!image.IsValid()) {
+        std::cerr << "Failed to load texture: " << imagePath << std::endl;
+        return false;
+    }
+
+    report = TextureBakeReport();
+    report.format = format;
+    report.width = image.width;
+    report.height = image.height;
+
+    std::vector<std::vector<unsigned char>> blocks;
+    // BC5 holds vectors (normal map XY), which must be averaged as stored, not as sRGB color
+    MipOptions chainOptions = mipOptions;
+    if (format == BlockFormat::BC5) {
+        chainOptions.gammaCorrect = false;
+    }
+    std::vector<ImageData> chain = MipGenerator::GenerateChain(image, chainOptions);
+    for (const ImageData& level : chain) {
+        blocks.push_back(BlockCompression::Encode(format, level.pixels.data(), level.width, level.height, level.channels));
+        report.uncompressedBytes += level.ByteSize();
+        report.compressedBytes += blocks.back().size();
+    }
+
+    std::vector<unsigned char> decoded = BlockCompression::Decode(format, blocks[0].data(), image.width, image.height);
+    report.error = BlockCompression::MeasureError(format, image.pixels.data(), image.channels, decoded.data(), image.width, image.height);
+    report.levels = static_cast<int>(blocks.size());
+
+    std::vector<KtxLevel> levels(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        levels[i].data = blocks[i].data();
+        levels[i].size = blocks[i].size();
+    }
+
+    KtxHeader header = KtxFile::MakeHeader(BlockCompression::GlInternalFormat(format), 0, 0, report.width, report.height);
+    if (!KtxFile::Write(CompressedPathFor(imagePath), header, levels, source)) {
+        std::cerr << "Failed to write " << CompressedPathFor(imagePath) << std::endl;
+        return false;
+    }
+    return true;
+}
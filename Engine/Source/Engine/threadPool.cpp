@@ -0,0 +1,74 @@
+#include "threadPool.h"
+
+namespace {
+
+    thread_local bool t_isWorker = false;
+
+}
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+    static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tasks.empty()) {
+            return false;
+        }
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+    }
+
+    task();
+    return true;
+}
+
+bool ThreadPool::IsWorkerThread()
+{
+    return t_isWorker;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    t_isWorker = true;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,86 @@
+#include "uniformBuffers.h"
+
+#include "shaderHelper.h"
+
+UniformBuffers::~UniformBuffers()
+{
+    if (m_frameBuffer != 0) {
+        GLuint buffers[] = { m_frameBuffer, m_viewBuffer, m_drawBuffer };
+        glDeleteBuffers(3, buffers);
+    }
+}
+
+void UniformBuffers::Create()
+{
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_drawStride = (sizeof(DrawUniforms) + alignment - 1) / alignment * alignment;
+
+    glGenBuffers(1, &m_frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &m_viewBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_viewBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ViewUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &m_drawBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_drawBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_drawStride * DRAW_SLOTS, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, m_frameBuffer);
+    glBindBufferBase(GL_UNIFORM_BUFFER, VIEW_BINDING, m_viewBuffer);
+}
+
+void UniformBuffers::BeginFrame(const FrameUniforms& frame)
+{
+    if (m_frameBuffer == 0) {
+        Create();
+    }
+
+    m_stats = UniformBufferStats();
+    Upload(m_frameBuffer, 0, &frame, sizeof(frame));
+}
+
+void UniformBuffers::SetView(const ViewUniforms& view)
+{
+    Upload(m_viewBuffer, 0, &view, sizeof(view));
+}
+
+void UniformBuffers::PushDraw(const DrawUniforms& draw)
+{
+    // Orphaning hands the driver a fresh store instead of waiting on draws still reading the old one
+    if (m_drawCursor == DRAW_SLOTS) {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_drawBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, m_drawStride * DRAW_SLOTS, nullptr, GL_STREAM_DRAW);
+        m_drawCursor = 0;
+    }
+
+    size_t offset = m_drawCursor++ * m_drawStride;
+    Upload(m_drawBuffer, offset, &draw, sizeof(draw));
+    glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_BINDING, m_drawBuffer, offset, sizeof(DrawUniforms));
+    m_stats.rangeBinds++;
+}
+
+void UniformBuffers::AssignBindings(const Shader& shader)
+{
+    const std::pair<UniformId, GLuint> blocks[] = {
+        { "FrameUniforms"_u, FRAME_BINDING },
+        { "ViewUniforms"_u, VIEW_BINDING },
+        { "DrawUniforms"_u, DRAW_BINDING },
+    };
+    for (const auto& [block, binding] : blocks) {
+        GLint index = shader.blockIndex(block);
+        if (index >= 0) {
+            glUniformBlockBinding(shader.ID, static_cast<GLuint>(index), binding);
+        }
+    }
+}
+
+void UniformBuffers::Upload(GLuint buffer, size_t offset, const void* data, size_t size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_stats.uploads++;
+    m_stats.bytes += size;
+}
@@ -0,0 +1,190 @@
+#include "vertexFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <glad/glad.h>
+#include <gtc/packing.hpp>
+
+namespace {
+
+    struct CompactVertex {
+        float position[3];
+        uint32_t uv;     // half2
+        uint32_t normal; // GL_INT_2_10_10_10_REV
+    };
+
+    struct CompactQuantizedVertex {
+        int16_t position[4]; // snorm16, w unused
+        uint32_t uv;
+        uint32_t normal;
+    };
+
+    static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay tightly packed");
+    static_assert(sizeof(CompactQuantizedVertex) == 16, "CompactQuantizedVertex must stay tightly packed");
+
+    uint32_t PackNormal(const glm::vec3& normal)
+    {
+        float length = glm::length(normal);
+        glm::vec3 unit = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        return glm::packSnorm3x10_1x2(glm::vec4(unit, 0.0f));
+    }
+
+    int16_t PackSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+}
+
+size_t VertexFormats::Stride(VertexFormat format)
+{
+    switch (format) {
+    case VertexFormat::Compact: return sizeof(CompactVertex);
+    case VertexFormat::CompactQuantized: return sizeof(CompactQuantizedVertex);
+    default: return sizeof(Vertex);
+    }
+}
+
+PositionDequantization VertexFormats::Dequantization(VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    PositionDequantization dequantization;
+    if (format == VertexFormat::CompactQuantized && boundsMin.x <= boundsMax.x) {
+        dequantization.offset = (boundsMin + boundsMax) * 0.5f;
+        // Flat axes still need a non-zero scale to round-trip
+        dequantization.scale = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-20f));
+    }
+    return dequantization;
+}
+
+std::vector<unsigned char> VertexFormats::Pack(VertexFormat format, const std::vector<Vertex>& vertices, const PositionDequantization& dequantization)
+{
+    size_t stride = Stride(format);
+    std::vector<unsigned char> packed(vertices.size() * stride);
+
+    if (format == VertexFormat::Float32) {
+        memcpy(packed.data(), vertices.data(), packed.size());
+        return packed;
+    }
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        PackVertex(format, vertices[i], dequantization, packed.data() + i * stride);
+    }
+    return packed;
+}
+
+void VertexFormats::PackVertex(VertexFormat format, const Vertex& vertex, const PositionDequantization& dequantization, unsigned char* target)
+{
+    switch (format) {
+    case VertexFormat::Float32:
+        memcpy(target, &vertex, sizeof(Vertex));
+        break;
+    case VertexFormat::Compact: {
+        CompactVertex packed;
+        memcpy(packed.position, &vertex.position[0], sizeof(packed.position));
+        packed.uv = glm::packHalf2x16(vertex.uv);
+        packed.normal = PackNormal(vertex.normal);
+        memcpy(target, &packed, sizeof(packed));
+        break;
+    }
+    case VertexFormat::CompactQuantized: {
+        CompactQuantizedVertex packed;
+        glm::vec3 normalized = (vertex.position - dequantization.offset) / dequantization.scale;
+        packed.position[0] = PackSnorm16(normalized.x);
+        packed.position[1] = PackSnorm16(normalized.y);
+        packed.position[2] = PackSnorm16(normalized.z);
+        packed.position[3] = 0;
+        packed.uv = glm::packHalf2x16(vertex.uv);
+        packed.normal = PackNormal(vertex.normal);
+        memcpy(target, &packed, sizeof(packed));
+        break;
+    }
+    }
+}
+
+Vertex VertexFormats::Unpack(VertexFormat format, const unsigned char* packed, const PositionDequantization& dequantization)
+{
+    Vertex vertex;
+
+    switch (format) {
+    case VertexFormat::Float32:
+        memcpy(&vertex, packed, sizeof(Vertex));
+        break;
+    case VertexFormat::Compact: {
+        CompactVertex source;
+        memcpy(&source, packed, sizeof(source));
+        vertex.position = glm::vec3(source.position[0], source.position[1], source.position[2]);
+        vertex.uv = glm::unpackHalf2x16(source.uv);
+        vertex.normal = glm::vec3(glm::unpackSnorm3x10_1x2(source.normal));
+        break;
+    }
+    case VertexFormat::CompactQuantized: {
+        CompactQuantizedVertex source;
+        memcpy(&source, packed, sizeof(source));
+        // Matches GL's snorm conversion: max(c / 32767, -1)
+        glm::vec3 normalized = glm::max(glm::vec3(source.position[0], source.position[1], source.position[2]) / 32767.0f, glm::vec3(-1.0f));
+        vertex.position = normalized * dequantization.scale + dequantization.offset;
+        vertex.uv = glm::unpackHalf2x16(source.uv);
+        vertex.normal = glm::vec3(glm::unpackSnorm3x10_1x2(source.normal));
+        break;
+    }
+    }
+
+    return vertex;
+}
+
+VertexQuantizationError VertexFormats::MeasureError(VertexFormat format, const std::vector<Vertex>& vertices, const std::vector<unsigned char>& packed, const PositionDequantization& dequantization)
+{
+    VertexQuantizationError error;
+    size_t stride = Stride(format);
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& original = vertices[i];
+        Vertex decoded = Unpack(format, packed.data() + i * stride, dequantization);
+
+        float positionError = glm::length(decoded.position - original.position);
+        error.maxPosition = std::max(error.maxPosition, positionError);
+        error.meanPosition += positionError;
+
+        glm::vec2 uvError = glm::abs(decoded.uv - original.uv);
+        error.maxUv = std::max(error.maxUv, std::max(uvError.x, uvError.y));
+
+        float originalLength = glm::length(original.normal);
+        float decodedLength = glm::length(decoded.normal);
+        if (originalLength > 0.0f && decodedLength > 0.0f) {
+            float cosine = std::clamp(glm::dot(original.normal / originalLength, decoded.normal / decodedLength), -1.0f, 1.0f);
+            error.maxNormalDegrees = std::max(error.maxNormalDegrees, glm::degrees(std::acos(cosine)));
+        }
+    }
+
+    if (!vertices.empty()) {
+        error.meanPosition /= static_cast<double>(vertices.size());
+    }
+    return error;
+}
+
+void VertexFormats::SetupAttributes(VertexFormat format)
+{
+    GLsizei stride = static_cast<GLsizei>(Stride(format));
+
+    switch (format) {
+    case VertexFormat::Float32:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, position)); // Position
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, uv)); // UV
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, normal)); // Normal
+        break;
+    case VertexFormat::Compact:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, position));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, uv));
+        glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+        break;
+    case VertexFormat::CompactQuantized:
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(CompactQuantizedVertex, position));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactQuantizedVertex, uv));
+        glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompactQuantizedVertex, normal));
+        break;
+    }
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
@@ -0,0 +1,196 @@
+#include "vfs.h"
+
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <utility>
+
+#include "engineLog.h"
+#include "lz4Block.h"
+
+VfsFile::VfsFile(const std::string& path)
+{
+    Open(path);
+}
+
+VfsFile::VfsFile(VfsFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+VfsFile& VfsFile::operator=(VfsFile&& other) noexcept
+{
+    // Moving the mapping and the buffer keeps their addresses, so m_data stays valid
+    if (this != &other) {
+        m_mapped = std::move(other.m_mapped);
+        m_buffer = std::move(other.m_buffer);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_isOpen = std::exchange(other.m_isOpen, false);
+        m_isArchived = std::exchange(other.m_isArchived, false);
+    }
+    return *this;
+}
+
+bool VfsFile::Open(const std::string& path)
+{
+    return Vfs::Shared().Open(path, *this);
+}
+
+void VfsFile::Close()
+{
+    m_mapped.Close();
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+    m_isArchived = false;
+}
+
+Vfs& Vfs::Shared()
+{
+    static Vfs vfs;
+    return vfs;
+}
+
+std::string Vfs::Normalize(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    if (error) {
+        absolute = path;
+    }
+    return absolute.lexically_normal().generic_string();
+}
+
+bool Vfs::Mount(const std::string& archivePath, const std::string& rootDirectory)
+{
+    auto mount = std::make_unique<MountedArchive>();
+    if (!mount->archive.Open(archivePath)) {
+        std::cerr << "Failed to mount archive: " << archivePath << std::endl;
+        return false;
+    }
+
+    mount->root = Normalize(rootDirectory);
+    if (mount->root.empty() || mount->root.back() != '/') {
+        mount->root += '/';
+    }
+
+    if (EngineLog::Verbose) {
+        std::cout << "Mounted '" << archivePath << "' (" << mount->archive.EntryCount() << " entries) at '" << mount->root << "'\n";
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_mounts.insert(m_mounts.begin(), std::move(mount));
+    return true;
+}
+
+size_t Vfs::MountCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_mounts.size();
+}
+
+const PakEntry* Vfs::FindArchived(const std::string& path, const PakArchive*& archive) const
+{
+    // Mounts are never removed, so entries and archives stay valid after the lock is released
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (m_mounts.empty()) {
+        return nullptr;
+    }
+
+    std::string normalized = Normalize(path);
+    for (const std::unique_ptr<MountedArchive>& mount : m_mounts) {
+        if (normalized.compare(0, mount->root.size(), mount->root) != 0) {
+            continue;
+        }
+        const PakEntry* entry = mount->archive.Find(std::string_view(normalized).substr(mount->root.size()));
+        if (entry) {
+            archive = &mount->archive;
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool Vfs::Open(const std::string& path, VfsFile& file) const
+{
+    file.Close();
+
+    const PakArchive* archive = nullptr;
+    const PakEntry* entry = FindArchived(path, archive);
+    if (!entry) {
+        if (!file.m_mapped.Open(path)) {
+            return false;
+        }
+        file.m_data = file.m_mapped.Data();
+        file.m_size = file.m_mapped.Size();
+        file.m_isOpen = true;
+        m_looseOpens++;
+        return true;
+    }
+
+    if (entry->compression == static_cast<uint32_t>(PakCompression::None)) {
+        file.m_data = archive->EntryData(*entry);
+        m_archivedOpens++;
+    }
+    else {
+        file.m_buffer.resize(entry->originalSize);
+        if (!Lz4::Decompress(archive->EntryData(*entry), entry->size, file.m_buffer.data(), file.m_buffer.size())) {
+            std::cerr << "Corrupt archive entry: " << archive->Name(*entry) << std::endl;
+            file.Close();
+            return false;
+        }
+        file.m_data = file.m_buffer.data();
+        m_decompressedOpens++;
+        m_decompressedBytes += entry->originalSize;
+    }
+
+    file.m_size = entry->originalSize;
+    file.m_isOpen = true;
+    file.m_isArchived = true;
+    return true;
+}
+
+bool Vfs::ReadText(const std::string& path, std::string& text) const
+{
+    VfsFile file;
+    if (!Open(path, file)) {
+        return false;
+    }
+    text.assign(file.Data(), file.Size());
+    return true;
+}
+
+bool Vfs::Exists(const std::string& path) const
+{
+    const PakArchive* archive = nullptr;
+    if (FindArchived(path, archive)) {
+        return true;
+    }
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+bool Vfs::ArchivedContentHash(const std::string& path, uint64_t& contentHash, uint64_t& size) const
+{
+    const PakArchive* archive = nullptr;
+    const PakEntry* entry = FindArchived(path, archive);
+    if (!entry) {
+        return false;
+    }
+    contentHash = entry->contentHash;
+    size = entry->originalSize;
+    return true;
+}
+
+VfsStats Vfs::Stats() const
+{
+    VfsStats stats;
+    stats.archivedOpens = m_archivedOpens;
+    stats.decompressedOpens = m_decompressedOpens;
+    stats.looseOpens = m_looseOpens;
+    stats.decompressedBytes = m_decompressedBytes;
+    return stats;
+}